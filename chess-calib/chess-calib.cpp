@@ -1,5 +1,8 @@
 #include <iostream> // Console outputs
+#include <sstream>
 #include <vector>
+#include <string>
+#include <cmath>
 using namespace std;
 
 #include "opencv2/core/core.hpp"
@@ -265,18 +268,309 @@ int calibrateChess(vector< Point2f >& refcorners, Size boardsize, Size scnsize,
 
 
 
+bool readBatch(const vector< string >& sources, int maxframes, vector< Mat >& images, vector< string >& names)
+{
+  for (size_t s = 0; s < sources.size(); s++) {
+    const string& src = sources[s];
+    string ext = src.substr(src.find_last_of(".") + 1);
+
+    if ( (ext == "png") || (ext == "jpg") || (ext == "jpeg") || (ext == "PNG") || (ext == "JPG") || (ext == "JPEG") ) {
+      Mat ims = imread(src, CV_LOAD_IMAGE_COLOR);
+      if (ims.empty())
+        cerr << "Failed to load image file from: " << src << endl;
+      else {
+        images.push_back(ims);
+        names.push_back(src);
+      }
+      continue;
+    }
+
+    VideoCapture videocap(src);
+    if (! videocap.isOpened() ) {
+      cerr << "Failed to open video file at: " << src << endl;
+      continue;
+    }
+
+    // Frames are only decoded when kept, the others are merely grabbed
+    int count = (int) videocap.get(CV_CAP_PROP_FRAME_COUNT);
+    int stride = (count > maxframes) ? count / maxframes : 1;
+    int kept = 0;
+    for (int f = 0; (kept < maxframes) && videocap.grab(); f++) {
+      if (f % stride)
+        continue;
+      Mat ims;
+      if (! (videocap.retrieve(ims) && ims.data) )
+        break;
+      images.push_back(ims.clone()); // The capture reuses its buffer
+      ostringstream name;
+      name << src << " #" << f;
+      names.push_back(name.str());
+      kept++;
+    }
+    cout << "Frames taken from " << src << ": " << kept << endl;
+  }
+
+  return !images.empty();
+}
+
+
+
+double reprojError(const vector< Point2f >& imcorners, const vector< Point2f >& refcorners, const Mat& M)
+{
+  vector< Point2f > projected;
+  perspectiveTransform(imcorners, projected, M);
+
+  double sum = 0;
+  for (size_t c = 0; c < projected.size(); c++) {
+    Point2f d = projected[c] - refcorners[c];
+    sum += d.x * d.x + d.y * d.y;
+  }
+  return projected.empty() ? 0 : sqrt(sum / projected.size());
+}
+
+
+
+/*
+  squareMean
+  Function averaging the gray level of a square of the scene plane, as seen in the image
+    gray: input
+      Grayscale image
+    Minv: input
+      Transformation matrix from the scene to the image plane
+    tl: input
+      Top-left corner of the square within the scene plane
+    step: input
+      Side of the square in scene units
+    Returns the mean gray level of a grid of points inside the square, -1 if none lies within the image
+*/
+static double squareMean(const Mat& gray, const Mat& Minv, Point2f tl, float step)
+{
+  vector< Point2f > points, projected;
+  for (int j = 1; j <= 5; j++) // Away from the edges, which the corner detection blurs
+    for (int i = 1; i <= 5; i++)
+      points.push_back(Point2f(tl.x + step * (0.1f + 0.8f * i / 6), tl.y + step * (0.1f + 0.8f * j / 6)));
+  perspectiveTransform(points, projected, Minv);
+
+  double sum = 0;
+  int n = 0;
+  for (size_t p = 0; p < projected.size(); p++) {
+    int x = cvRound(projected[p].x), y = cvRound(projected[p].y);
+    if ( (x >= 0) && (y >= 0) && (x < gray.cols) && (y < gray.rows) ) {
+      sum += gray.at< uchar >(y, x);
+      n++;
+    }
+  }
+  return n ? sum / n : -1;
+}
+
+
+
+bool orderCorners(const Mat& gray, vector< Point2f >& imcorners, Size boardsize, const vector< Point2f >& refcorners, calibResult& result)
+{
+  static const char* names[8] = { "as detected", "reversed", "rows mirrored", "columns mirrored",
+                                  "transposed", "transposed and reversed", "transposed, rows mirrored", "transposed, columns mirrored" };
+  int w = boardsize.width, h = boardsize.height;
+  int norders = (w == h) ? 8 : 4; // Square boards may also be detected column by column
+
+  // Center of the board in the image, around which the orientation of each transformation is measured
+  Point2f center(0, 0);
+  for (size_t c = 0; c < imcorners.size(); c++)
+    center += imcorners[c];
+  center = center * (1. / imcorners.size());
+
+  // Board origin square, and the square on its right, within the scene plane
+  float step = refcorners[1].x - refcorners[0].x;
+  Point2f origin = refcorners[0] - Point2f(step, step), right = refcorners[0] - Point2f(0, step);
+
+  vector< vector< Point2f > > orders;
+  vector< int > indices;
+  vector< Mat > Ms;
+  vector< double > darkness, angles;
+  for (int o = 0; o < norders; o++) {
+    vector< Point2f > ordered(imcorners.size());
+    bool transposed = (o >= 4), flipx = (o % 4 == 1) || (o % 4 == 2), flipy = (o % 4 == 1) || (o % 4 == 3);
+    for (int j = 0; j < h; j++)
+      for (int i = 0; i < w; i++) {
+        int si = flipx ? w - 1 - i : i, sj = flipy ? h - 1 - j : j;
+        ordered[j * w + i] = transposed ? imcorners[si * w + sj] : imcorners[sj * w + si];
+      }
+
+    Mat M = findHomography(ordered, refcorners);
+    if (M.empty())
+      continue;
+
+    // Orientation: a camera looking at the scene never sees it mirrored
+    vector< Point2f > axes(3), mapped;
+    axes[0] = center;
+    axes[1] = center + Point2f(1, 0);
+    axes[2] = center + Point2f(0, 1);
+    perspectiveTransform(axes, mapped, M);
+    Point2f ex = mapped[1] - mapped[0], ey = mapped[2] - mapped[0];
+    if (ex.x * ey.y - ex.y * ey.x <= 0)
+      continue;
+
+    Mat Minv = M.inv();
+    orders.push_back(ordered);
+    indices.push_back(o);
+    Ms.push_back(M);
+    double dark = squareMean(gray, Minv, origin, step), light = squareMean(gray, Minv, right, step);
+    darkness.push_back( (dark >= 0) && (light >= 0) ? light - dark : 0 );
+    angles.push_back(fabs(atan2(ex.y, ex.x)));
+  }
+  if (orders.empty())
+    return false;
+
+  // A dark origin square only decides when the candidates disagree about it, otherwise the least rotated one wins
+  double maxdark = 0;
+  for (size_t o = 0; o < orders.size(); o++)
+    maxdark = max(maxdark, darkness[o]);
+
+  int best = -1;
+  for (size_t o = 0; o < orders.size(); o++) {
+    if ( (maxdark > 30) && (darkness[o] < maxdark / 2) )
+      continue;
+    if ( (best < 0) || (angles[o] < angles[best]) )
+      best = o;
+  }
+
+  imcorners = orders[best];
+  result.M = Ms[best];
+  result.error = reprojError(imcorners, refcorners, result.M);
+  result.order = names[indices[best]];
+  return true;
+}
+
+
+
+/*
+  CalibrateImages
+  Loop body calibrating a range of images of a batch, each one independently of the others
+*/
+class CalibrateImages : public ParallelLoopBody
+{
+public:
+  CalibrateImages(const vector< Mat >& images, const vector< Point2f >& refcorners, Size boardsize, bool extra_acc, vector< calibResult >& results) :
+    _images(images), _refcorners(refcorners), _boardsize(boardsize), _extra_acc(extra_acc), _results(results) {}
+
+  void operator()(const Range& range) const
+  {
+    for (int i = range.start; i < range.end; i++) {
+      calibResult& result = _results[i];
+      result.found = false;
+
+      Mat imgray;
+      cvtColor(_images[i], imgray, CV_BGR2GRAY);
+      vector< Point2f > imcorners;
+      if (! findChessboardCorners(imgray, _boardsize, imcorners, CALIB_CB_ADAPTIVE_THRESH + CALIB_CB_NORMALIZE_IMAGE + CALIB_CB_FAST_CHECK) )
+        continue;
+
+      if (_extra_acc)
+        cornerSubPix(imgray, imcorners, Size(11,11), Size(-1,-1), TermCriteria( CV_TERMCRIT_EPS+CV_TERMCRIT_ITER, 30, 0.1 ));
+
+      result.found = orderCorners(imgray, imcorners, _boardsize, _refcorners, result);
+    }
+  }
+
+private:
+  const vector< Mat >& _images;
+  const vector< Point2f >& _refcorners;
+  Size _boardsize;
+  bool _extra_acc;
+  vector< calibResult >& _results;
+};
+
+
+
+int calibrateBatch(const vector< Point2f >& refcorners, Size boardsize, Size scnsize, const vector< Mat >& images, const vector< string >& names, char* savename, bool extra_acc)
+{
+  vector< calibResult > results(images.size());
+  int64 t0 = getTickCount();
+  parallel_for_(Range(0, images.size()), CalibrateImages(images, refcorners, boardsize, extra_acc, results));
+  double seconds = (getTickCount() - t0) / getTickFrequency();
+
+  int best = -1;
+  for (size_t i = 0; i < results.size(); i++) {
+    if (results[i].found) {
+      cout << names[i] << ": reprojection error " << results[i].error << " with corners " << results[i].order << endl;
+      if ( (best < 0) || (results[i].error < results[best].error) )
+        best = i;
+    }
+    else
+      cout << names[i] << ": failed to find chessboard corners." << endl;
+  }
+  cout << images.size() << " images processed in " << seconds << " s" << endl;
+
+  if (best < 0) {
+    cout << "Could not calibrate successfully. Try improving the image resolution or placing the chessboard elsewhere." << endl;
+    return EXIT_FAILURE;
+  }
+  cout << endl << "Best image: " << names[best] << ", reprojection error " << results[best].error << endl;
+
+  bool saved = saveCalibData(results[best].M, savename);
+  cout << (saved ? "Transformation matrix successfully saved at: " : "Failed to save transformation matrix at: ") << savename << endl;
+
+  //* # WARP # Save the reprojected image, to be checked instead of answering prompts
+  Mat improj;
+  warpPerspective(images[best], improj, results[best].M, scnsize);  // Apply the transformation on the whole image
+  drawChessboardCorners(improj, boardsize, Mat(refcorners), true); // Draw expected corners on the projected image
+  string imd = savename; // Named after the calibration data, so that calibrating several cameras keeps every check image
+  size_t ext = imd.find_last_of("./");
+  if ( (ext != string::npos) && (imd[ext] == '.') )
+    imd.erase(ext);
+  imd += ".check.png";
+  bool checked = imwrite(imd, improj);
+  cout << (checked ? "Reprojected image successfully saved at: " : "Failed to save reprojected image at: ") << imd << endl;
+  // # WARP #*/
+
+  return saved ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+
 #define param 4
 #define bound "# -----------------------------------"
 #define acc true // This should become an optional parameter
+#define maxframes 64 // Largest number of frames taken from each video file in batch mode
 
 int main(int args, char* argv[])
 {
+  if ( (args > 1) && (string(argv[1]) == "--batch") ) { // Non-interactive calibration from many images
+    if (args < param + 2) {
+      cerr << "Too few arguments! Number given: " << args - 1 << endl << "Usage: chess-calib --batch <chess-data.yml> <scn-data.yml> <calib-data.yml> <source> [<source>...]" << endl
+           << "  Sources are image files, or video files from which up to " << maxframes << " frames are taken" << endl;
+      exit(EXIT_FAILURE);
+    }
+
+    cout << bound << endl << "Camera calibration with chessboard, batch mode" << endl << endl;
+    vector< Point2f > refcorners;
+    Size boardsize, scnsize;
+    vector< Mat > images;
+    vector< string > names;
+
+    bool ref_loaded = readRef(argv[2], refcorners, boardsize); // Load corners' positions in the destination plane
+    cout << ( ref_loaded ? "Chessboard data successfully loaded from: " : "Failed to load chessboard data from: ") << argv[2] << endl;
+    bool scn_loaded = readScene(argv[3], scnsize); // Load scene's dimensions
+    cout << ( scn_loaded ? "Scene data successfully loaded from: " : "Failed to load scene data from: ") << argv[3] << endl;
+    bool src_loaded = readBatch(vector< string >(argv + 5, argv + args), maxframes, images, names); // Load every calibration image
+    cout << ( src_loaded ? "Calibration images successfully loaded: " : "Failed to load any calibration image, given: ") << args - 5 << " sources" << endl;
+
+    if (ref_loaded && scn_loaded && src_loaded) {
+      cout << bound << endl << endl;
+      return calibrateBatch(refcorners, boardsize, scnsize, images, names, argv[4], acc);
+    }
+    else {
+      cerr << bound << endl << "Aborting calibration..." << endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+
   if (args != param + 1) {
     if (args < param + 1)
       cout << "Too few arguments!";
     else
       cout << "Too many arguments!";
-    cerr << " Number given: " << args - 1 << endl << "Usage: chess-calib <chess-data.yml> <scn-data.yml> <source> <calib-data.yml>" << endl;
+    cerr << " Number given: " << args - 1 << endl << "Usage: chess-calib <chess-data.yml> <scn-data.yml> <source> <calib-data.yml>" << endl
+         << "   or: chess-calib --batch <chess-data.yml> <scn-data.yml> <calib-data.yml> <source> [<source>...]" << endl;
     exit(EXIT_FAILURE);
   }
   
@@ -118,4 +118,98 @@ bool saveCalibData(Mat M, char* filename);
     extra_acc: input
       Corner detection accuracy improvement option
 */
-int calibrateChess(vector< Point2f >& refcorners, Size boardsize, Size scnsize, Mat ims, char* savename, bool extra_acc);
\ No newline at end of file
+int calibrateChess(vector< Point2f >& refcorners, Size boardsize, Size scnsize, Mat ims, char* savename, bool extra_acc);
+
+
+
+/*
+  calibResult
+  Structure gathering the outcome of the calibration of a single image
+*/
+struct calibResult {
+  bool found;   // Whether the chessboard corners were found
+  Mat M;        // Transformation matrix from the image to the scene plane
+  double error; // Root mean square distance between the reprojected corners and the reference ones, in scene units
+  string order; // Corner ordering that was kept
+};
+
+
+
+/*
+  readBatch
+  Function loading the calibration images of a batch
+    sources: input
+      Full paths and names to image files, or to video files whose frames are sampled
+    maxframes: input
+      Largest number of frames taken from each video file, evenly spread over the file
+    images: output
+      Loaded images
+    names: output
+      Name of each loaded image, its file name followed by the index of the frame for videos
+    Returns if at least one image could be loaded
+*/
+bool readBatch(const vector< string >& sources, int maxframes, vector< Mat >& images, vector< string >& names);
+
+
+
+/*
+  reprojError
+  Function measuring how well a transformation matrix maps the detected corners onto the reference ones
+    imcorners: input
+      Positions of the corners within the image plane
+    refcorners: input
+      Positions of the reference corners within the scene plane, in the same order
+    M: input
+      Transformation matrix from the image to the scene plane
+    Returns the root mean square distance between the reprojected corners and the reference ones, in scene units
+*/
+double reprojError(const vector< Point2f >& imcorners, const vector< Point2f >& refcorners, const Mat& M);
+
+
+
+/*
+  orderCorners
+  Function resolving the ordering of the detected corners without asking the user
+  findChessboardCorners may start from any corner of the board and go either way, the same grid being found in every case
+  Each ordering the board allows is tried, as done interactively by reversing the corners:
+  orderings that would mirror the scene are rejected, then those that do not put a dark square at the board origin
+  when the board's corner squares tell them apart, and the one least rotated with respect to the image is kept
+    gray: input
+      Grayscale calibration image
+    imcorners: input output
+      As input: corners as detected, row by row
+      As output: corners in the kept ordering, matching refcorners
+    boardsize: input
+      Dimensions of the "inner" chessboard
+    refcorners: input
+      Positions of the reference corners within the scene plane
+    result: output
+      Transformation matrix, reprojection error and name of the kept ordering
+    Returns if an ordering could be kept
+*/
+bool orderCorners(const Mat& gray, vector< Point2f >& imcorners, Size boardsize, const vector< Point2f >& refcorners, calibResult& result);
+
+
+
+/*
+  calibrateBatch
+  Function calibrating a camera from many images without any interaction
+  Every image is processed in parallel: corner detection, sub-pixel refinement and ordering, homography and reprojection error
+  The transformation matrix with the lowest reprojection error is saved,
+  along with the reprojected image and the expected corners for a later review, in <savename>.check.png, extension of savename excluded
+    refcorners: input
+      Positions of the reference corners within the scene plane
+    boardsize: input
+      Dimensions of the "inner" chessboard to detect
+    scnsize: input
+      Dimensions of the scene
+    images: input
+      Calibration images, taken from the same fixed camera
+    names: input
+      Name of each image, for the console report
+    savename:
+      Full path and name to the calibration data to save as a YML file
+    extra_acc: input
+      Corner detection accuracy improvement option
+*/
+int calibrateBatch(const vector< Point2f >& refcorners, Size boardsize, Size scnsize, const vector< Mat >& images, const vector< string >& names, char* savename, bool extra_acc);
@@ -1,10 +1,22 @@
 #include "network.hpp"
 
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+
 using namespace OSSIA;
 using namespace std;
 
 Network::Network(){
     _simRunning = true;
+    _deadband = 0;
+    _angleDeadband = 0;
+    _minPeriod = std::chrono::steady_clock::duration::zero();
+    _tick = std::chrono::steady_clock::duration::zero();
+    _horizon = 0.25f;
+    _dropped = 0;
+    _batches = 0;
+    _published = 0;
 
     // declare this program "B" as Local device
     _localProtocol = Local::create();
@@ -16,19 +28,158 @@ Network::Network(){
     // execution of publication on the networkThread thread
     std::thread t(&Network::publication, this);
     std::swap(t, _networkThread);
-    _networkThread.detach();
-
 }
 
 Network::~Network(){
+    setSimRunning(false);
+}
+
+// whether a pose moved or turned beyond the deadband since the last one published for its Metabot
+static bool changed(const pose& p, const pose& last, float deadband, float angleDeadband){
+    if (p.visible != last.visible)
+        return true;
+
+    float turn = std::fabs(p.angle - last.angle);
+    if (turn > 180) // angles wrap around at +/-180 degrees
+        turn = 360 - turn;
+
+    // Distance moved in the scene, compared squared
+    float dx = p.x - last.x, dy = p.y - last.y;
+    return (dx * dx + dy * dy > deadband * deadband) || (turn > angleDeadband);
 }
 
 void Network::publication(){
     auto minuitProtocol = Minuit::create("127.0.0.1", 13579, 8888);
     auto minuitDevice = Device::create(minuitProtocol, "i-score");
 
-    while (_simRunning == true)
-        ;
+    typedef std::chrono::steady_clock clock;
+    std::vector<pose> snapshot;  // latest snapshot handed over
+    std::vector<pose> current;   // poses of the snapshot extrapolated to now
+    std::vector<pose> batch;     // poses that changed
+    std::vector<int> gone;       // Metabots that left the snapshots
+    struct published {
+        pose last;               // last pose published for the Metabot
+        unsigned long batch;     // last batch whose snapshot listed the Metabot
+    };
+    std::unordered_map<int, published> last; // by ID, Metabots evicted from the registry are dropped
+    unsigned long count = 0;
+    MotionModel model;           // motion of each Metabot, fed with every snapshot when extrapolating
+    clock::time_point stamp;     // capture time of the snapshot
+    Publisher publisher;
+    Remover remover;
+    float deadband = 0, angleDeadband = 0;
+    bool extrapolate = false;
+    unsigned long seen = 0;   // version of the last snapshot read
+    auto fresh = [this, &seen]{ return (_store.getVersion() != seen) || !_simRunning; };
+    auto next = clock::now(); // earliest time of the next batch
+    while (true) {
+        bool measured = false, due = true;
+        {
+            std::unique_lock<std::mutex> lock(_queueLock);
+            if (_tick > clock::duration::zero()) {
+                // wake up for every snapshot to feed the model, but publish only on the fixed ticks
+                _queueCond.wait_until(lock, next, fresh);
+                if (!_simRunning)
+                    break;
+                auto now = clock::now();
+                due = (now >= next);
+                if (due)
+                    next = std::max(next + _tick, now);
+            }
+            else {
+                // sleep until a snapshot is handed over or the simulation stops
+                _queueCond.wait(lock, fresh);
+                if (_store.getVersion() == seen)
+                    break;
+
+                // respect the publish rate, newer snapshots replace the pending one meanwhile
+                if (_minPeriod > clock::duration::zero())
+                    _queueCond.wait_until(lock, next, [this]{ return !_simRunning; });
+                next = clock::now() + _minPeriod;
+            }
+
+            publisher = _publisher;
+            remover = _remover;
+            deadband = _deadband;
+            angleDeadband = _angleDeadband;
+            extrapolate = (_tick > clock::duration::zero());
+            model.setHorizon(_horizon);
+        }
+
+        // copy the latest snapshot, the scan thread keeps writing meanwhile
+        if (_store.getVersion() != seen) {
+            unsigned long version = _store.read(snapshot, stamp);
+            if (version > seen + 1)
+                _dropped += version - seen - 1; // replaced before being read
+            seen = version;
+            measured = true;
+        }
+
+        const std::vector<pose>* poses = &snapshot;
+        if (extrapolate) {
+            if (measured)
+                for (const auto & p : snapshot)
+                    if (p.visible)
+                        model.update(p.ID, cv::Point2f(p.x, p.y), p.angle, stamp);
+            if (!due)
+                continue;
+
+            // publish every Metabot at its pose extrapolated to now, hiding the latency of the pipeline
+            auto now = clock::now();
+            current = snapshot;
+            for (auto & p : current) {
+                cv::Point2f center;
+                if (model.predict(p.ID, now, center, p.angle)) {
+                    p.x = center.x;
+                    p.y = center.y;
+                }
+            }
+            poses = &current;
+        }
+
+        // keep only the Metabots whose pose changed enough
+        batch.clear();
+        count++;
+        for (const auto & p : *poses) {
+            auto found = last.find(p.ID);
+            if (found != last.end()) {
+                found->second.batch = count;
+                if (!changed(p, found->second.last, deadband, angleDeadband))
+                    continue;
+                found->second.last = p;
+            }
+            else
+                last[p.ID] = published{p, count};
+            batch.push_back(p);
+        }
+
+        // every Metabot of the snapshot is known by now, the others were evicted
+        gone.clear();
+        if (last.size() > poses->size()) {
+            for (auto k = last.begin(); k != last.end(); ) {
+                if (k->second.batch != count) {
+                    model.forget(k->first);
+                    gone.push_back(k->first);
+                    k = last.erase(k);
+                }
+                else
+                    ++k;
+            }
+        }
+
+        // publish outside of the lock, the scan loop keeps handing snapshots over meanwhile
+        if (publisher && !batch.empty()) {
+            publisher(batch);
+            std::lock_guard<std::mutex> lock(_queueLock);
+            _batches++;
+            _published += batch.size();
+        }
+
+        // decided here rather than from a snapshot, so that a newer snapshot cannot hide the removal
+        if (remover)
+            for (int ID : gone)
+                remover(ID);
+    }
     std::cout << "network thread closed" << std::endl;
 }
 
@@ -37,5 +188,76 @@ std::shared_ptr<Node> Network::getSceneNode(){
 }
 
 void Network::setSimRunning(bool b){
-    _simRunning = b;
+    {
+        std::lock_guard<std::mutex> lock(_queueLock);
+        _simRunning = b;
+    }
+    _queueCond.notify_one();
+
+    if (!b && _networkThread.joinable() && _networkThread.get_id() != std::this_thread::get_id())
+        _networkThread.join();
+}
+
+void Network::setPublisher(Publisher publisher){
+    std::lock_guard<std::mutex> lock(_queueLock);
+    _publisher = publisher;
+}
+
+void Network::setRemover(Remover remover){
+    std::lock_guard<std::mutex> lock(_queueLock);
+    _remover = remover;
+}
+
+void Network::setDeadband(float position, float angle){
+    std::lock_guard<std::mutex> lock(_queueLock);
+    _deadband = position;
+    _angleDeadband = angle;
+}
+
+void Network::setMaxRate(float rate){
+    std::lock_guard<std::mutex> lock(_queueLock);
+    if (rate > 0)
+        _minPeriod = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / rate));
+    else
+        _minPeriod = std::chrono::steady_clock::duration::zero();
+}
+
+void Network::setExtrapolation(float rate, float horizon){
+    {
+        std::lock_guard<std::mutex> lock(_queueLock);
+        if (rate > 0)
+            _tick = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / rate));
+        else
+            _tick = std::chrono::steady_clock::duration::zero();
+        _horizon = horizon;
+    }
+    _queueCond.notify_one();
+}
+
+void Network::publishSnapshot(const std::vector<pose>& snapshot, std::chrono::steady_clock::time_point stamp){
+    _store.write(snapshot, stamp);
+    {
+        // taken only for an instant: the network thread is either about to check the version or already waiting,
+        // so the wake-up cannot be lost
+        std::lock_guard<std::mutex> lock(_queueLock);
+    }
+    _queueCond.notify_one();
+}
+
+unsigned long Network::readSnapshot(std::vector<pose>& snapshot, std::chrono::steady_clock::time_point& stamp) const{
+    return _store.read(snapshot, stamp);
+}
+
+unsigned long Network::getDropped(){
+    return _dropped;
+}
+
+unsigned long Network::getBatches(){
+    std::lock_guard<std::mutex> lock(_queueLock);
+    return _batches;
+}
+
+unsigned long Network::getPublished(){
+    std::lock_guard<std::mutex> lock(_queueLock);
+    return _published;
 }
@@ -5,6 +5,11 @@
 #include <memory>
 #include <functional>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <chrono>
 
 #if defined(Bool)
 #undef Bool
@@ -16,6 +21,9 @@
 #undef False
 #endif
 
+#include "motionmodel.hpp"
+#include "posestore.hpp"
+
 #include "Network/Address.h"
 #include "Network/Device.h"
 #include "Network/Protocol/Local.h"
@@ -26,24 +34,77 @@ using namespace OSSIA;
 class Network
 {
 public:
+    // function publishing the poses that changed since the last batch, called once per batch from the network thread
+    typedef std::function<void(const std::vector<pose>&)> Publisher;
+    // function removing a Metabot that left the snapshots, called from the network thread after the batch of the same snapshot
+    typedef std::function<void(int)> Remover;
+
     Network();
     ~Network();
 
-    // expose the application and a scene node to i-score
+    // expose the application and a scene node to i-score, then publish the snapshots until stopped
     void publication();
 
     // get the scene node
     std::shared_ptr<Node> getSceneNode();
 
-    // set the simRunning boolean
+    // set the simRunning boolean, setting it to false stops the network thread and waits for it
     void setSimRunning(bool b);
 
+    // set the function publishing each batch of changed poses
+    void setPublisher(Publisher publisher);
+
+    // set the function removing the Metabots evicted from the registry, it must hide them since no batch will
+    void setRemover(Remover remover);
+
+    // set the distance and the rotation in degrees a Metabot must exceed before its pose is published again
+    void setDeadband(float position, float angle);
+
+    // set the largest number of batches published per second, 0 publishes every snapshot
+    void setMaxRate(float rate);
+
+    // publish at a fixed rate the poses extrapolated to the current time by a motion model, 0 publishes every snapshot as is
+    // horizon is the longest extrapolation in seconds
+    void setExtrapolation(float rate, float horizon);
+
+    // hand the poses of every Metabot in a frame to the network thread, never waits for a reader
+    // the network lock is only taken for an instant to wake the thread up, never while the poses are copied
+    // Metabots missing from the snapshot are forgotten, and published again as new ones if they come back
+    // stamp is the capture time of the frame, a snapshot not used yet is replaced by the newer one
+    // only the scan thread may call it
+    void publishSnapshot(const std::vector<pose>& snapshot, std::chrono::steady_clock::time_point stamp);
+
+    // copy the latest snapshot from any thread, without blocking the scan thread
+    // returns its version, incremented by every snapshot, 0 if none was handed over yet
+    unsigned long readSnapshot(std::vector<pose>& snapshot, std::chrono::steady_clock::time_point& stamp) const;
+
+    // number of snapshots replaced before being published
+    unsigned long getDropped();
+
+    // number of batches and poses actually published
+    unsigned long getBatches();
+    unsigned long getPublished();
+
 private:
     std::shared_ptr<Protocol> _localProtocol;
     std::shared_ptr<Device> _localDevice;
     std::shared_ptr<Node> _localSceneNode;
     std::thread _networkThread;
-    bool _simRunning;
+    std::atomic<bool> _simRunning;
+
+    Publisher _publisher;
+    Remover _remover;
+    std::mutex _queueLock;
+    std::condition_variable _queueCond; // signaled when a snapshot is handed over or the thread must stop
+    PoseStore _store;                   // latest snapshot, shared without locks
+    float _deadband;
+    float _angleDeadband;
+    std::chrono::steady_clock::duration _minPeriod; // shortest time between two batches
+    std::chrono::steady_clock::duration _tick;      // period of the extrapolated batches, zero when not extrapolating
+    float _horizon;                                 // longest extrapolation in seconds
+    std::atomic<unsigned long> _dropped;
+    unsigned long _batches;
+    unsigned long _published;
 };
 
 #endif // NETWORK_H
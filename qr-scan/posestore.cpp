@@ -0,0 +1,99 @@
+#include <thread>
+#include <algorithm>
+
+#include "posestore.hpp"
+
+
+
+PoseStore::PoseStore(size_t capacity) :
+  _sequence(0),
+  _buffer(nullptr),
+  _count(0),
+  _stamp(0),
+  _retries(0)
+{
+  poseBuffer* buffer = new poseBuffer;
+  buffer->capacity = (capacity > 0) ? capacity : 1;
+  buffer->slots.reset(new poseSlot[buffer->capacity]()); // Zeroed, a reader may see them before the first write
+  _buffers.push_back(unique_ptr< poseBuffer >(buffer));
+  _buffer.store(buffer, memory_order_release);
+}
+
+
+
+void PoseStore::write(const vector< pose >& poses, clock::time_point stamp)
+{
+  unsigned long sequence = _sequence.load(memory_order_relaxed);
+  _sequence.store(sequence + 1, memory_order_relaxed); // Odd: readers will start over
+  atomic_thread_fence(memory_order_release);
+
+  poseBuffer* buffer = _buffer.load(memory_order_relaxed);
+  if (poses.size() > buffer->capacity) {
+    buffer = new poseBuffer;
+    buffer->capacity = max(poses.size(), 2 * _buffers.back()->capacity);
+    buffer->slots.reset(new poseSlot[buffer->capacity]());
+    _buffers.push_back(unique_ptr< poseBuffer >(buffer)); // The previous one stays valid for the readers copying from it
+    _buffer.store(buffer, memory_order_release);
+  }
+
+  for (size_t i = 0; i < poses.size(); i++) {
+    poseSlot& slot = buffer->slots[i];
+    slot.ID.store(poses[i].ID, memory_order_relaxed);
+    slot.x.store(poses[i].x, memory_order_relaxed);
+    slot.y.store(poses[i].y, memory_order_relaxed);
+    slot.angle.store(poses[i].angle, memory_order_relaxed);
+    slot.visible.store(poses[i].visible, memory_order_relaxed);
+  }
+  _count.store(poses.size(), memory_order_relaxed);
+  _stamp.store(stamp.time_since_epoch().count(), memory_order_relaxed);
+
+  _sequence.store(sequence + 2, memory_order_release); // Even again: the snapshot is complete
+}
+
+
+
+unsigned long PoseStore::read(vector< pose >& poses, clock::time_point& stamp) const
+{
+  while (true) {
+    unsigned long sequence = _sequence.load(memory_order_acquire);
+    if (sequence & 1) { // A write is in progress, it only takes a few microseconds
+      _retries.fetch_add(1, memory_order_relaxed);
+      this_thread::yield();
+      continue;
+    }
+
+    const poseBuffer* buffer = _buffer.load(memory_order_acquire);
+    size_t count = min(_count.load(memory_order_relaxed), buffer->capacity); // Bounded in case the count is newer than the buffer
+    poses.resize(count);
+    for (size_t i = 0; i < count; i++) {
+      const poseSlot& slot = buffer->slots[i];
+      poses[i].ID = slot.ID.load(memory_order_relaxed);
+      poses[i].x = slot.x.load(memory_order_relaxed);
+      poses[i].y = slot.y.load(memory_order_relaxed);
+      poses[i].angle = slot.angle.load(memory_order_relaxed);
+      poses[i].visible = slot.visible.load(memory_order_relaxed);
+    }
+    clock::rep rep = _stamp.load(memory_order_relaxed);
+
+    atomic_thread_fence(memory_order_acquire);
+    if (_sequence.load(memory_order_relaxed) == sequence) {
+      stamp = clock::time_point(clock::duration(rep));
+      return sequence / 2;
+    }
+    _retries.fetch_add(1, memory_order_relaxed);
+  }
+}
+
+
+
+unsigned long PoseStore::getVersion() const
+{
+  return _sequence.load(memory_order_acquire) / 2;
+}
+
+
+
+unsigned long PoseStore::getRetries() const
+{
+  return _retries.load(memory_order_relaxed);
+}
@@ -0,0 +1,99 @@
+#ifndef POSESTORE_H
+#define POSESTORE_H
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+
+using namespace std;
+
+
+
+/*
+  pose
+  Structure describing the pose of a Metabot within the scene plane, as computed by the scan loop
+*/
+struct pose {
+  int ID;
+  float x;
+  float y;
+  float angle;
+  bool visible; // Whether the Metabot was found in the last frame, its last known pose is kept otherwise
+};
+
+
+
+/*
+  PoseStore
+  Class sharing the latest snapshot of poses from the scan thread with any number of reader threads, without locks
+  Writes are guarded by a sequence counter, odd while a snapshot is being written: a reader copies the snapshot,
+  then starts over if the counter changed meanwhile, so that it always gets a coherent snapshot
+  The writer never waits for the readers, a slow reader only skips the snapshots written while it was busy
+  Every field is stored as an atomic, so that a copy racing with a write is only discarded, never undefined
+  Storage grows with the number of poses, the buffers outgrown are kept until the store is destroyed,
+  since a reader may still be copying from them
+*/
+class PoseStore
+{
+public:
+  typedef chrono::steady_clock clock;
+
+  /*
+    capacity: input
+      Number of poses the store holds before its storage has to grow
+  */
+  PoseStore(size_t capacity = 64);
+
+  /*
+    write
+    Function replacing the snapshot, only one thread may write
+      poses: input
+        Poses of the new snapshot
+      stamp: input
+        Capture time of the frame the poses were computed from
+  */
+  void write(const vector< pose >& poses, clock::time_point stamp);
+
+  /*
+    read
+    Function copying the latest snapshot, from any thread
+      poses: output
+        Poses of the snapshot
+      stamp: output
+        Capture time of the snapshot
+      Returns the version of the snapshot, 0 if none was written yet
+  */
+  unsigned long read(vector< pose >& poses, clock::time_point& stamp) const;
+
+  // Version of the latest snapshot, incremented by every write
+  unsigned long getVersion() const;
+
+  // Number of copies started over because a write happened meanwhile
+  unsigned long getRetries() const;
+
+private:
+  // Pose stored field by field
+  struct poseSlot {
+    atomic< int > ID;
+    atomic< float > x;
+    atomic< float > y;
+    atomic< float > angle;
+    atomic< bool > visible;
+  };
+
+  struct poseBuffer {
+    size_t capacity;
+    unique_ptr< poseSlot[] > slots;
+  };
+
+  atomic< unsigned long > _sequence; // Twice the version, plus one while a write is in progress
+  atomic< poseBuffer* > _buffer;     // Current storage
+  atomic< size_t > _count;           // Number of poses in the snapshot
+  atomic< clock::rep > _stamp;
+  mutable atomic< unsigned long > _retries;
+
+  vector< unique_ptr< poseBuffer > > _buffers; // Every buffer allocated, only touched by the writer
+};
+
+#endif // POSESTORE_H
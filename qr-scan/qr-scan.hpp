@@ -47,27 +47,68 @@ bool readScene( const char* filename, Size& scnsize);
 /*
   openCam
   Function attempting to connect to a camera at up to ten different indices
-    videocap: output
-      VideoCapture object corresponding to the first found camera
+    source: output
+      Frame source corresponding to the first found camera
     index: input output
       As input: first camera index to try
       As output: last camera index tried, index of the first found camera if applicable
+    luma: input
+      Whether the camera should deliver the luma plane only
     Returns if the program could connect to a camera
 */
-bool openCam(VideoCapture& videocap, int& index);
+bool openCam(Ptr< FrameSource >& source, int& index, bool luma);
 
 
 
 /*
   openAVI
   Function attempting to open an AVI video file
-    videocap: output
-      VideoCapture object corresponding to the opened file
+    source: output
+      Frame source corresponding to the opened file
     path: input
       Full path and name to the AVI file to open
+    luma: input
+      Whether the file should deliver the luma plane only
+    Returns if the program could open the video file
+*/
+bool openAVI(Ptr< FrameSource >& source, const char* path, bool luma);
+
+
+
+/*
+  openY4M
+  Function attempting to open a YUV4MPEG2 video file, whose luma plane is read directly
+    source: output
+      Frame source corresponding to the opened file
+    path: input
+      Full path and name to the Y4M file to open
     Returns if the program could open the video file
 */
-bool openAVI(VideoCapture& videocap, char* path);
+bool openY4M(Ptr< FrameSource >& source, const char* path);
+
+
+
+/*
+  loadCamera
+  Function loading the reprojection data of a camera and opening its video source
+    projname: input
+      Full path and name to the YML file from which to get reprojection data
+      About required YML structure, refer to example file
+    source: input
+      String indicating which source will be used : AVI file, Y4M file or camera
+      source should be a full path to an AVI or Y4M file
+      or an integer corresponding to the index of the first camera to try to connect to
+    luma: input
+      Whether the video source should deliver the luma plane only
+    M: output
+      Loaded transformation matrix
+    frames: output
+      Frame source corresponding to the loaded video source
+    live: output
+      Whether the source is a live camera, whose frames may be dropped, or a file to be read entirely
+    Returns if the data loading was successful
+*/
+bool loadCamera(const char* projname, const char* source, bool luma, Mat& M, Ptr< FrameSource >& frames, bool& live);
 
 
 
@@ -81,18 +122,22 @@ bool openAVI(VideoCapture& videocap, char* path);
       Full path and name to the YML file from which to get scene reference data
       About required YML structure, refer to example file
     source: input
-      String indicating which source will be used : AVI file or camera
-      source should be a full path to an AVI file
+      String indicating which source will be used : AVI file, Y4M file or camera
+      source should be a full path to an AVI or Y4M file
       or an integer corresponding to the index of the first camera to try to connect to
+    luma: input
+      Whether the video source should deliver the luma plane only
     M: output
       Loaded transformation matrix
     scnsize: output
       Loaded dimensions of the scene
-    videocap: output
-      VideoCapture object corresponding to the loaded video source
+    frames: output
+      Frame source corresponding to the loaded video source
+    live: output
+      Whether the source is a live camera, whose frames may be dropped, or a file to be read entirely
     Returns if the data loading was successful
 */
-bool loadData(const char* projname, const char* scnname, char* source, Mat& M, Size& scnsize, VideoCapture& videocap);
+bool loadData(const char* projname, const char* scnname, char* source, bool luma, Mat& M, Size& scnsize, Ptr< FrameSource >& frames, bool& live);
 
 
 
@@ -152,6 +197,18 @@ void interrupt_loop(int sig);
 
 
 
+/*
+  reportLatency
+  Function writing the latency of each stage of the scan loop in the console, and into a file if requested
+    stats: input
+      Latency histograms gathered by the loop
+    opts: input
+      Options of the run, the report is also saved into opts.latencyfile unless it is empty
+*/
+void reportLatency(const LatencyStats& stats, const trackOptions& opts);
+
+
+
 /*
   scan
   Function scanning an image taken from a calibrated camera to identify QR or bar codes
@@ -159,10 +216,22 @@ void interrupt_loop(int sig);
       Transformation matrix to reproject the images from the video stream
     scnsize: input
       Dimensions of the scene, bounding the reprojected images
-    videocap: input
-      VideoCapture object corresponding to the video source
+    source: input
+      Opened video source, delivering BGR frames or their luma plane
+    live: input
+      Whether the source is a live camera, in which case only the latest frame is processed
+    anchors: input
+      Anchor tags declared in the scene, watched for calibration drift
+    opts: input
+      Options of the run
+      With opts.corners, the camera frame is scanned as is and only the symbols' corners are reprojected
+      With opts.remap, the grayscale camera frame is reprojected through precomputed tables
+      With opts.roi, most frames are scanned only around the symbols found previously
+      With opts.tiles, the image is scanned as overlapping tiles on a pool of threads
+      With opts.drift, the anchors are checked every opts.driftperiod seconds and the transformation corrected in the background
+      The latency of each stage is written in the console when the loop ends, and into opts.latencyfile if given
 */
-int scan(Mat M, Size scnsize, VideoCapture& videocap);
+int scan(Mat M, Size scnsize, FrameSource& source, bool live, const vector< anchorTag >& anchors, const trackOptions& opts);
 
 
 
@@ -174,4 +243,22 @@ int scan(Mat M, Size scnsize, VideoCapture& videocap);
   dIndex: input
     Index of the GPU device to enable
 */
-int scanGPU(Mat M, Size scnsize, VideoCapture& videocap, const int dIndex);
\ No newline at end of file
+int scanGPU(Mat M, Size scnsize, FrameSource& source, bool live, const trackOptions& opts, const int dIndex);
+
+
+/*
+  scanMulti
+  Function tracking symbols with several calibrated cameras looking at the same scene
+  Each camera is read, reprojected and scanned on its own threads, symbols with the same data are fused into one pose
+    Ms: input
+      Transformation matrices reprojecting the images of each camera into the scene
+    scnsize: input
+      Dimensions of the scene shared by every camera
+    sources: input
+      Opened video source of each camera
+    lives: input
+      Whether each source is a live camera, in which case only its latest frame is processed
+    opts: input
+      Options of the run, applied to every camera
+*/
+int scanMulti(const vector< Mat >& Ms, Size scnsize, vector< Ptr< FrameSource > >& sources, const vector< bool >& lives, const trackOptions& opts);
\ No newline at end of file
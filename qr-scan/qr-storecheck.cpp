@@ -0,0 +1,116 @@
+#include <iostream> // Console outputs
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <stdlib.h>
+using namespace std;
+
+#include "posestore.hpp"
+
+#include "qr-storecheck.hpp"
+
+// The snapshot sizes cycle up to this, so that the storage grows while readers copy from it
+#define maxPoses 70
+
+
+
+/*
+  synthSnapshot
+  Function filling the poses of the snapshot of a given version
+*/
+static void synthSnapshot(unsigned long version, vector< pose >& poses)
+{
+  poses.resize(version % maxPoses + 1);
+  for(size_t i = 0; i < poses.size(); i++) {
+    poses[i].ID = i;
+    poses[i].x = version;
+    poses[i].y = -(float) version;
+    poses[i].angle = 0.5f * version;
+    poses[i].visible = (version + i) % 2;
+  }
+}
+
+
+
+/*
+  coherent
+  Function telling if a copy is the snapshot of the version it was read with
+*/
+static bool coherent(unsigned long version, const vector< pose >& poses, PoseStore::clock::time_point stamp)
+{
+  if (version == 0)
+    return poses.empty() && (stamp.time_since_epoch().count() == 0);
+
+  vector< pose > expected;
+  synthSnapshot(version, expected);
+  if ( (poses.size() != expected.size()) || (stamp.time_since_epoch().count() != (PoseStore::clock::rep) version) )
+    return false;
+
+  for(size_t i = 0; i < poses.size(); i++)
+    if ( (poses[i].ID != expected[i].ID) || (poses[i].x != expected[i].x) || (poses[i].y != expected[i].y) ||
+         (poses[i].angle != expected[i].angle) || (poses[i].visible != expected[i].visible) )
+      return false;
+  return true;
+}
+
+
+
+bool checkStore(int readers, unsigned long writes)
+{
+  PoseStore store(4); // Small, to grow a few times
+  atomic< bool > writing(true);
+  atomic< unsigned long > reads(0), torn(0), backwards(0);
+
+  vector< thread > threads;
+  for(int r = 0; r < readers; r++)
+    threads.push_back(thread([&]() {
+      vector< pose > poses;
+      PoseStore::clock::time_point stamp;
+      unsigned long last = 0;
+      while (writing) {
+        unsigned long version = store.read(poses, stamp);
+        if (! coherent(version, poses, stamp) )
+          torn++;
+        if (version < last)
+          backwards++;
+        last = version;
+        reads++;
+      }
+    }));
+
+  vector< pose > poses;
+  for(unsigned long v = 1; v <= writes; v++) {
+    synthSnapshot(v, poses);
+    store.write(poses, PoseStore::clock::time_point(PoseStore::clock::duration(v)));
+  }
+  writing = false;
+  for(size_t t = 0; t < threads.size(); t++)
+    threads[t].join();
+
+  // The last snapshot is read back once the writer is done
+  PoseStore::clock::time_point stamp;
+  unsigned long last = store.read(poses, stamp);
+  bool OK = (torn == 0) && (backwards == 0) && (last == writes) && (store.getVersion() == writes) && coherent(last, poses, stamp);
+
+  cout << writes << " snapshot(s) written, " << reads << " read by " << readers << " thread(s), " << store.getRetries() << " retried" << endl;
+  if (!OK)
+    cerr << "Pose store: " << torn << " incoherent copy(ies), " << backwards << " version(s) going back, last version " << last << " instead of " << writes << endl;
+  return OK;
+}
+
+
+
+int main(int args, char* argv[])
+{
+  int readers = (args > 1) ? atoi(argv[1]) : 3;
+  unsigned long writes = (args > 2) ? strtoul(argv[2], NULL, 10) : 200000;
+  if ( (args > 3) || (readers <= 0) || (writes == 0) ) {
+    cerr << "Usage: qr-storecheck [<readers> [<writes>]]" << endl
+         << "  Checks that the readers of the pose store never copy a snapshot torn by the writer, default: 3 readers, 200000 writes" << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  bool OK = checkStore(readers, writes);
+  cout << "Pose store seqlock: " << (OK ? "OK" : "FAILED") << endl;
+  return OK ? EXIT_SUCCESS : EXIT_FAILURE;
+}
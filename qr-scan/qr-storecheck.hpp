@@ -0,0 +1,15 @@
+using namespace std;
+
+
+
+/*
+  checkStore
+  Function checking that readers racing with the writer of a pose store only ever copy complete snapshots
+  Each snapshot is filled from its version, so that a copy mixing two writes is told apart
+    readers: input
+      Number of reader threads
+    writes: input
+      Number of snapshots written
+    Returns if every copy was coherent and the versions read never went back
+*/
+bool checkStore(int readers, unsigned long writes);
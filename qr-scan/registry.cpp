@@ -0,0 +1,123 @@
+#include <algorithm>
+
+#include "registry.hpp"
+
+
+
+MetabotRegistry::MetabotRegistry(float timeout) :
+  _timeout(chrono::duration_cast< clock::duration >(chrono::duration< double >(timeout > 0 ? timeout : 0))),
+  _evicted(0)
+{
+}
+
+
+
+void MetabotRegistry::beginFrame()
+{
+  fill(_visible.begin(), _visible.end(), 0);
+}
+
+
+
+bool MetabotRegistry::see(int ID, Point2f center, float angle, clock::time_point stamp)
+{
+  int slot;
+  unordered_map< int, int >::iterator found = _slots.find(ID);
+  if (found != _slots.end()) {
+    slot = found->second;
+    if (_visible[slot])
+      return false;
+  }
+  else {
+    slot = _ids.size();
+    _slots[ID] = slot;
+    _ids.push_back(ID);
+    _x.push_back(0);
+    _y.push_back(0);
+    _angle.push_back(0);
+    _visible.push_back(0);
+    _seen.push_back(stamp);
+  }
+
+  _x[slot] = center.x;
+  _y[slot] = center.y;
+  _angle[slot] = angle;
+  _visible[slot] = 1;
+  _seen[slot] = stamp;
+  return true;
+}
+
+
+
+int MetabotRegistry::evict(clock::time_point now)
+{
+  if (_timeout == clock::duration::zero())
+    return 0;
+
+  int evicted = 0;
+  for (int slot = 0; slot < (int) _ids.size(); ) {
+    if (now - _seen[slot] > _timeout) {
+      remove(slot); // The last slot moves here, check it too
+      evicted++;
+    }
+    else
+      slot++;
+  }
+
+  _evicted += evicted;
+  return evicted;
+}
+
+
+
+void MetabotRegistry::snapshot(vector< pose >& poses) const
+{
+  poses.resize(_ids.size());
+  for (size_t slot = 0; slot < _ids.size(); slot++) {
+    pose& p = poses[slot];
+    p.ID = _ids[slot];
+    p.x = _x[slot];
+    p.y = _y[slot];
+    p.angle = _angle[slot];
+    p.visible = _visible[slot];
+  }
+}
+
+
+
+int MetabotRegistry::size() const
+{
+  return _ids.size();
+}
+
+
+
+unsigned long MetabotRegistry::getEvicted() const
+{
+  return _evicted;
+}
+
+
+
+void MetabotRegistry::remove(int slot)
+{
+  int last = _ids.size() - 1;
+  _slots.erase(_ids[slot]);
+
+  if (slot != last) {
+    _ids[slot] = _ids[last];
+    _x[slot] = _x[last];
+    _y[slot] = _y[last];
+    _angle[slot] = _angle[last];
+    _visible[slot] = _visible[last];
+    _seen[slot] = _seen[last];
+    _slots[_ids[slot]] = slot;
+  }
+
+  _ids.pop_back();
+  _x.pop_back();
+  _y.pop_back();
+  _angle.pop_back();
+  _visible.pop_back();
+  _seen.pop_back();
+}
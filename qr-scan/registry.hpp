@@ -0,0 +1,97 @@
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+
+#include "opencv2/core/core.hpp"
+
+#include "network.hpp"
+
+using namespace std;
+using namespace cv;
+
+
+
+/*
+  MetabotRegistry
+  Class keeping the last known pose of every Metabot seen in the scene, whatever the number and range of their IDs
+  Poses are stored as a flat table, one array per field, a hash map giving the slot of each ID in constant time
+  A Metabot enters the table the first time it is seen, and is evicted once it has not been seen for the timeout
+  Evicting moves the last slot into the freed one, so that the table stays dense
+*/
+class MetabotRegistry
+{
+public:
+  typedef chrono::steady_clock clock;
+
+  /*
+    timeout: input
+      Time in seconds after which a Metabot not seen is evicted, 0 to keep every Metabot for the whole run
+  */
+  MetabotRegistry(float timeout = 0);
+
+  /*
+    beginFrame
+    Function marking every Metabot as not visible, before the symbols of a new frame are recorded
+  */
+  void beginFrame();
+
+  /*
+    see
+    Function recording the pose of a Metabot found in the current frame, adding it if it is new
+      ID: input
+        ID of the Metabot
+      center: input
+        Position of the center of the Metabot within the scene plane
+      angle: input
+        Orientation angle of the Metabot within the scene plane
+      stamp: input
+        Capture time of the frame
+      Returns false if the Metabot was already seen in the current frame
+  */
+  bool see(int ID, Point2f center, float angle, clock::time_point stamp);
+
+  /*
+    evict
+    Function removing the Metabots not seen for longer than the timeout
+      now: input
+        Time against which the last sightings are compared, usually the capture time of the current frame
+      Returns the number of Metabots evicted
+  */
+  int evict(clock::time_point now);
+
+  /*
+    snapshot
+    Function listing the state of every Metabot in the table
+      poses: output
+        Last known pose of each Metabot, visible if it was seen in the current frame
+  */
+  void snapshot(vector< pose >& poses) const;
+
+  // Number of Metabots in the table
+  int size() const;
+
+  // Total number of Metabots evicted
+  unsigned long getEvicted() const;
+
+private:
+  // Function moving the last slot into the given one and shrinking the table
+  void remove(int slot);
+
+  clock::duration _timeout;
+  unordered_map< int, int > _slots; // Slot of each ID
+
+  // Table of the Metabots, one entry per slot
+  vector< int > _ids;
+  vector< float > _x;
+  vector< float > _y;
+  vector< float > _angle;
+  vector< char > _visible;
+  vector< clock::time_point > _seen; // Capture time of the last frame the Metabot was found in
+
+  unsigned long _evicted;
+};
+
+#endif // REGISTRY_H
@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <cmath>
+
+#include "camerafusion.hpp"
+
+
+
+CameraFusion::cameraWorker::cameraWorker(const Mat& M, Size scnsize, const trackOptions& opts, FrameSource& source, bool live, LatencyStats& stats) :
+  grabber(source, !live),
+  pipeline(M, scnsize, opts),
+  clk(stats),
+  live(live),
+  fresh(false),
+  ended(false),
+  skipped(0)
+{
+}
+
+
+
+CameraFusion::CameraFusion(Size scnsize, const trackOptions& opts, int ncameras, LatencyStats& stats) :
+  _scnsize(scnsize),
+  _opts(opts),
+  _stats(stats),
+  _running(false)
+{
+  // Each camera has its own scanning pool: share the CPUs between them instead of oversubscribing
+  if ( (_opts.threads <= 0) && (ncameras > 1) )
+    _opts.threads = max(1, getNumberOfCPUs() / ncameras);
+}
+
+
+
+CameraFusion::~CameraFusion()
+{
+  stop();
+}
+
+
+
+void CameraFusion::addCamera(const Mat& M, FrameSource& source, bool live)
+{
+  _workers.push_back(unique_ptr< cameraWorker >(new cameraWorker(M, _scnsize, _opts, source, live, _stats)));
+}
+
+
+
+bool CameraFusion::start()
+{
+  if (_running || _workers.empty())
+    return false;
+
+  _running = true;
+  bool started = false;
+  for (size_t i = 0; i < _workers.size(); i++) {
+    cameraWorker* w = _workers[i].get();
+    if (w->grabber.start()) {
+      w->th = thread(&CameraFusion::work, this, w);
+      started = true;
+    }
+    else
+      w->ended = true; // Never opened: the other cameras go on without it
+  }
+
+  return started;
+}
+
+
+
+void CameraFusion::stop()
+{
+  {
+    lock_guard< mutex > guard(_lock);
+    _running = false;
+  }
+  _takenCond.notify_all();
+
+  // Stopping the grabbers makes the workers waiting for a frame give up
+  for (size_t i = 0; i < _workers.size(); i++)
+    _workers[i]->grabber.stop();
+  for (size_t i = 0; i < _workers.size(); i++)
+    if (_workers[i]->th.joinable())
+      _workers[i]->th.join();
+}
+
+
+
+void CameraFusion::work(cameraWorker* w)
+{
+  Mat frame; // Image that will be read
+
+  while (true) {
+    w->clk.start();
+    if (! w->grabber.retrieve(frame, w->stamp) )
+      break;
+    w->clk.lap(STAGE_CAPTURE);
+
+    w->pipeline.process(frame, w->symbols, w->clk);
+
+    unique_lock< mutex > guard(_lock);
+    if (! w->live) // Files: wait for the previous result to be fused, so that the streams stay aligned
+      _takenCond.wait(guard, [this, w]{ return !w->fresh || !_running; });
+    if (!_running)
+      break;
+
+    if (w->fresh) // The previous result was never fused: latest result wins
+      w->skipped++;
+    swap(w->symbols, w->result);
+    w->resultStamp = w->stamp;
+    w->fresh = true;
+
+    guard.unlock();
+    _resultCond.notify_all();
+  }
+
+  {
+    lock_guard< mutex > guard(_lock);
+    w->ended = true;
+  }
+  _resultCond.notify_all();
+}
+
+
+
+bool CameraFusion::retrieve(vector< qrSymbol >& symbols, chrono::steady_clock::time_point& stamp)
+{
+  symbols.clear();
+  bool available = false;
+  chrono::steady_clock::duration offset(0); // Sum of the capture times, relative to the first one
+  int nstamps = 0;
+
+  {
+    // Wait until every camera still running has a new result
+    unique_lock< mutex > guard(_lock);
+    _resultCond.wait(guard, [this]{
+      for (size_t i = 0; i < _workers.size(); i++)
+        if (!_workers[i]->fresh && !_workers[i]->ended)
+          return false;
+      return true;
+    });
+
+    // Take the results without copy, the workers go on meanwhile
+    for (size_t i = 0; i < _workers.size(); i++) {
+      cameraWorker* w = _workers[i].get();
+      w->taken.clear();
+      if (w->fresh) {
+        swap(w->result, w->taken);
+        w->takenStamp = w->resultStamp;
+        w->fresh = false;
+        available = true;
+
+        if (nstamps == 0)
+          stamp = w->takenStamp;
+        else
+          offset += w->takenStamp - stamp;
+        nstamps++;
+      }
+    }
+  }
+  _takenCond.notify_all();
+
+  if (!available) // Every camera ended
+    return false;
+  stamp += offset / nstamps;
+
+  // Merge the symbols with the same data: mean center, mean angle on the unit circle
+  _index.clear();
+  _poses.clear();
+  for (size_t i = 0; i < _workers.size(); i++) {
+    const vector< qrSymbol >& taken = _workers[i]->taken;
+    for (size_t s = 0; s < taken.size(); s++) {
+      const qrSymbol& symbol = taken[s];
+      float rad = symbol.angle * CV_PI / 180;
+
+      map< string, size_t >::iterator it = _index.find(symbol.data);
+      if (it == _index.end()) {
+        _index[symbol.data] = symbols.size();
+        symbols.push_back(symbol);
+        fusedPose p = { symbol.center, (float) cos(rad), (float) sin(rad), 1 };
+        _poses.push_back(p);
+      }
+      else {
+        fusedPose& p = _poses[it->second];
+        p.center += symbol.center;
+        p.cosSum += cos(rad);
+        p.sinSum += sin(rad);
+        p.count++;
+      }
+    }
+  }
+
+  for (size_t s = 0; s < symbols.size(); s++) {
+    const fusedPose& p = _poses[s];
+    if (p.count == 1)
+      continue;
+
+    qrSymbol& symbol = symbols[s];
+    Point2f center = p.center * (1.f / p.count);
+    symbol.pNorth += center - symbol.center; // Keep the north direction of the first detection, around the merged center
+    symbol.center = center;
+    symbol.angle = atan2(p.sinSum, p.cosSum) * 180 / CV_PI;
+  }
+
+  return true;
+}
+
+
+
+int CameraFusion::getCameras() const
+{
+  return _workers.size();
+}
+
+
+
+unsigned long CameraFusion::getCaptured(int camera)
+{
+  return _workers[camera]->grabber.getCaptured();
+}
+
+
+
+unsigned long CameraFusion::getProcessed(int camera)
+{
+  return _workers[camera]->grabber.getProcessed();
+}
+
+
+
+unsigned long CameraFusion::getDropped(int camera)
+{
+  return _workers[camera]->grabber.getDropped();
+}
+
+
+
+unsigned long CameraFusion::getSkipped(int camera)
+{
+  lock_guard< mutex > guard(_lock);
+  return _workers[camera]->skipped;
+}
@@ -0,0 +1,136 @@
+#ifndef CAMERAFUSION_H
+#define CAMERAFUSION_H
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "opencv2/core/core.hpp"
+
+#include "framesource.hpp"
+#include "framegrabber.hpp"
+#include "pipeline.hpp"
+#include "latency.hpp"
+#include "options.hpp"
+#include "symbols.hpp"
+
+using namespace std;
+using namespace cv;
+
+
+
+/*
+  CameraFusion
+  Class tracking symbols with several calibrated cameras looking at the same scene
+  Each camera has its own capture thread, and a worker thread reprojecting and scanning its frames with its own pipeline
+  Every fused frame gathers one result per camera still running, symbols with the same data are merged into a single pose
+  With live cameras each worker only keeps its latest result, with files each result is fused so that the streams stay aligned
+*/
+class CameraFusion
+{
+public:
+  /*
+    scnsize: input
+      Dimensions of the scene shared by every camera
+    opts: input
+      Options of the run, applied to the pipeline of every camera
+      When opts.threads is 0, the CPUs are shared between the scanning pools of the cameras
+    ncameras: input
+      Number of cameras that will be added
+    stats: input output
+      Latency histograms, the workers record the stages of their pipeline into it
+  */
+  CameraFusion(Size scnsize, const trackOptions& opts, int ncameras, LatencyStats& stats);
+  ~CameraFusion();
+
+  /*
+    addCamera
+    Function adding a camera before the threads are started
+      M: input
+        Transformation matrix reprojecting the frames of this camera into the scene
+      source: input
+        Opened video source, owned by the caller and kept alive until stop
+      live: input
+        Whether the source is a live camera, whose frames may be dropped, or a file to be read entirely
+  */
+  void addCamera(const Mat& M, FrameSource& source, bool live);
+
+  /*
+    start
+    Function launching the capture and worker threads of every camera
+    Returns if at least one camera could be started
+  */
+  bool start();
+
+  /*
+    stop
+    Function stopping every thread and waiting for them to end
+  */
+  void stop();
+
+  /*
+    retrieve
+    Function waiting for a new result from every camera still running and merging them
+      symbols: output
+        Symbols found by at least one camera, one per distinct data, with their pose in the scene plane
+      stamp: output
+        Mean capture time of the fused frames
+      Returns false once every camera has ended
+  */
+  bool retrieve(vector< qrSymbol >& symbols, chrono::steady_clock::time_point& stamp);
+
+  // Per-camera counters
+  int getCameras() const;
+  unsigned long getCaptured(int camera);
+  unsigned long getProcessed(int camera);
+  unsigned long getDropped(int camera);
+  unsigned long getSkipped(int camera); // Results replaced before being fused
+
+private:
+  // State owned by a camera worker
+  struct cameraWorker {
+    cameraWorker(const Mat& M, Size scnsize, const trackOptions& opts, FrameSource& source, bool live, LatencyStats& stats);
+
+    FrameGrabber grabber;
+    Pipeline pipeline;
+    StageClock clk;
+    bool live;
+    vector< qrSymbol > symbols; // Symbols found in the frame being processed
+    vector< qrSymbol > result;  // Symbols of the latest processed frame, waiting to be fused
+    vector< qrSymbol > taken;   // Result being fused
+    chrono::steady_clock::time_point stamp, resultStamp, takenStamp; // Capture times of the three results above
+    bool fresh;  // result was not fused yet
+    bool ended;  // The source failed or is exhausted
+    unsigned long skipped;
+    thread th;
+  };
+
+  // Merged pose of the symbols with the same data
+  struct fusedPose {
+    Point2f center;
+    float cosSum, sinSum; // Angles are averaged on the unit circle
+    int count;
+  };
+
+  // Worker thread main loop
+  void work(cameraWorker* w);
+
+  Size _scnsize;
+  trackOptions _opts;
+  LatencyStats& _stats;
+  vector< unique_ptr< cameraWorker > > _workers;
+
+  mutex _lock;
+  condition_variable _resultCond; // Signaled when a worker has a new result or ended
+  condition_variable _takenCond;  // Signaled when results were fused or the workers stop
+  bool _running;
+
+  map< string, size_t > _index; // Index in the fused symbols of each data
+  vector< fusedPose > _poses;
+};
+
+#endif // CAMERAFUSION_H
@@ -0,0 +1,283 @@
+#include <iostream>
+#include <algorithm>
+#include <math.h>
+
+#include "driftmonitor.hpp"
+#include "pipeline.hpp"
+
+// Number of frames in which an anchor must be found during a period for its mean center to be trusted
+#define minSightings 5
+
+
+
+bool readAnchors(const char* filename, vector< anchorTag >& anchors)
+{
+  anchors.clear();
+
+  FileStorage fs(filename, FileStorage::READ);
+  if ( !fs.isOpened() )
+    return false;
+
+  FileNode anchorsn = fs["Anchors"];
+  if ( anchorsn.empty() )
+    return true; // Declaring anchors is optional
+
+  if (! anchorsn.isSeq() )
+    return false;
+
+  for(size_t a = 0; a < anchorsn.size(); a++) {
+    FileNode anchorn = anchorsn[(int)a];
+    anchorTag anchor;
+    vector< float > position;
+
+    anchor.data = (string)anchorn["Data"];
+    anchorn["Position"] >> position;
+    int ID;
+    if ( anchor.data.empty() || symbolID(anchor.data, ID) || (position.size() != 2) )
+      return false; // An anchor encoding a number would be taken for a Metabot
+
+    anchor.position = Point2f(position[0], position[1]);
+    anchors.push_back(anchor);
+  }
+
+  fs.release();
+  return true;
+}
+
+
+
+DriftMonitor::DriftMonitor(const vector< anchorTag >& anchors, const Mat& M, Size scnsize, const trackOptions& opts) :
+  _anchors(anchors),
+  _scnsize(scnsize),
+  _opts(opts),
+  _period(chrono::duration_cast< chrono::steady_clock::duration >(chrono::duration< double >(opts.driftperiod))),
+  _sums(anchors.size()),
+  _counts(anchors.size(), 0),
+  _pending(false),
+  _running(false),
+  _checks(0),
+  _corrections(0),
+  _drift(0)
+{
+  M.convertTo(_M, CV_64F); // Corrections are composed in double precision
+}
+
+
+
+DriftMonitor::~DriftMonitor()
+{
+  stop();
+}
+
+
+
+bool DriftMonitor::start()
+{
+  if ( _running || _anchors.empty() || (_opts.drift <= 0) )
+    return false;
+
+  _running = true;
+  _watchThread = thread(&DriftMonitor::watch, this);
+  return true;
+}
+
+
+
+void DriftMonitor::stop()
+{
+  {
+    lock_guard<mutex> guard(_lock);
+    _running = false;
+  }
+  _stopCond.notify_all();
+
+  if (_watchThread.joinable())
+    _watchThread.join();
+}
+
+
+
+void DriftMonitor::observe(const vector< qrSymbol >& symbols)
+{
+  // Skip the frame rather than wait for the monitoring thread
+  unique_lock<mutex> lock(_lock, try_to_lock);
+  if (! (lock.owns_lock() && _running) )
+    return;
+
+  for(size_t s = 0; s < symbols.size(); s++)
+    for(size_t a = 0; a < _anchors.size(); a++)
+      if (symbols[s].data == _anchors[a].data) {
+        _sums[a] += Point2d(symbols[s].center.x, symbols[s].center.y);
+        _counts[a]++;
+        break;
+      }
+}
+
+
+
+bool DriftMonitor::retrieve(Mat& M, Ptr< WarpMap >& warpmap, Ptr< GrayWarp >& graywarp)
+{
+  unique_lock<mutex> lock(_lock, try_to_lock);
+  if (! (lock.owns_lock() && _pending) )
+    return false;
+
+  M = _nextM;
+  warpmap = _nextWarpmap;
+  graywarp = _nextGraywarp;
+  _nextWarpmap.release();
+  _nextGraywarp.release();
+  _pending = false;
+
+  // The measures made with the previous matrix would bias the next check
+  fill(_sums.begin(), _sums.end(), Point2d());
+  fill(_counts.begin(), _counts.end(), 0);
+  return true;
+}
+
+
+
+unsigned long DriftMonitor::getChecks()
+{
+  lock_guard<mutex> guard(_lock);
+  return _checks;
+}
+
+
+
+unsigned long DriftMonitor::getCorrections()
+{
+  lock_guard<mutex> guard(_lock);
+  return _corrections;
+}
+
+
+
+float DriftMonitor::getDrift()
+{
+  lock_guard<mutex> guard(_lock);
+  return _drift;
+}
+
+
+
+bool DriftMonitor::correction(const vector< Point2f >& measured, const vector< Point2f >& declared, Mat& C)
+{
+  int n = measured.size();
+  if (n < 2)
+    return false;
+
+  // Least squares fit, centered on the declared positions to keep the system well conditioned
+  Point2f origin;
+  for(int i = 0; i < n; i++)
+    origin += declared[i];
+  origin = (1. / n) * origin;
+
+  bool homography = (n >= 4);
+  Mat A = Mat::zeros(2 * n, homography ? 8 : 4, CV_64F);
+  Mat b(2 * n, 1, CV_64F);
+  for(int i = 0; i < n; i++) {
+    double x = measured[i].x - origin.x, y = measured[i].y - origin.y;
+    double u = declared[i].x - origin.x, v = declared[i].y - origin.y;
+    double* ru = A.ptr< double >(2 * i);
+    double* rv = A.ptr< double >(2 * i + 1);
+
+    if (homography) {
+      // u = (h0 x + h1 y + h2) / (h6 x + h7 y + 1), and likewise for v with h3, h4, h5
+      ru[0] = x; ru[1] = y; ru[2] = 1; ru[6] = -u * x; ru[7] = -u * y;
+      rv[3] = x; rv[4] = y; rv[5] = 1; rv[6] = -v * x; rv[7] = -v * y;
+    }
+    else {
+      // u = a x - b y + tx, v = b x + a y + ty
+      ru[0] = x; ru[1] = -y; ru[2] = 1;
+      rv[0] = y; rv[1] = x; rv[3] = 1;
+    }
+    b.at< double >(2 * i) = u;
+    b.at< double >(2 * i + 1) = v;
+  }
+
+  Mat h;
+  if (! solve(A, b, h, DECOMP_SVD) )
+    return false;
+
+  const double* p = h.ptr< double >();
+  Mat centered;
+  if (homography)
+    centered = (Mat_< double >(3, 3) << p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], 1);
+  else
+    centered = (Mat_< double >(3, 3) << p[0], -p[1], p[2], p[1], p[0], p[3], 0, 0, 1);
+
+  // Back to scene coordinates
+  Mat shift = (Mat_< double >(3, 3) << 1, 0, -origin.x, 0, 1, -origin.y, 0, 0, 1);
+  Mat unshift = (Mat_< double >(3, 3) << 1, 0, origin.x, 0, 1, origin.y, 0, 0, 1);
+  C = unshift * centered * shift;
+  return checkRange(C);
+}
+
+
+
+void DriftMonitor::watch()
+{
+  unique_lock<mutex> lock(_lock);
+  chrono::steady_clock::time_point next = chrono::steady_clock::now() + _period;
+
+  while (_running) {
+    if ( _stopCond.wait_until(lock, next, [this]{ return !_running; }) )
+      break;
+    next += _period;
+
+    if (_pending)
+      continue; // The loop still reprojects with the previous matrix, and so are the measures
+
+    // Mean center of each anchor seen often enough during the period
+    vector< Point2f > measured, declared;
+    for(size_t a = 0; a < _anchors.size(); a++) {
+      if (_counts[a] >= minSightings) {
+        Point2d mean = (1. / _counts[a]) * _sums[a];
+        measured.push_back(Point2f(mean.x, mean.y));
+        declared.push_back(_anchors[a].position);
+      }
+      _sums[a] = Point2d();
+      _counts[a] = 0;
+    }
+    _checks++;
+    if ( measured.empty() )
+      continue;
+
+    double squares = 0;
+    for(size_t i = 0; i < measured.size(); i++) {
+      Point2f d = measured[i] - declared[i];
+      squares += d.x * d.x + d.y * d.y;
+    }
+    _drift = sqrt(squares / measured.size());
+    if (_drift <= _opts.drift)
+      continue;
+
+    // Fit and tables are computed without holding the lock, the loop keeps adding its measures meanwhile
+    float drift = _drift;
+    Mat M = _M;
+    lock.unlock();
+
+    Mat C, corrected;
+    Ptr< WarpMap > warpmap;
+    Ptr< GrayWarp > graywarp;
+    bool fitted = correction(measured, declared, C);
+    if (fitted) {
+      corrected = C * M;
+      corrected /= corrected.at< double >(2, 2);
+      Pipeline::prepareTables(corrected, _scnsize, _opts, warpmap, graywarp);
+      cerr << "Calibration drift of " << drift << " scene units over " << measured.size() << " anchors: transformation corrected" << endl;
+    }
+    else
+      cerr << "Calibration drift of " << drift << " scene units, but too few anchors seen to correct it" << endl;
+
+    lock.lock();
+    if (fitted) {
+      _M = corrected;
+      _nextM = corrected;
+      _nextWarpmap = warpmap;
+      _nextGraywarp = graywarp;
+      _pending = true;
+      _corrections++;
+    }
+  }
+}
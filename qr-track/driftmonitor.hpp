@@ -0,0 +1,155 @@
+#ifndef DRIFTMONITOR_H
+#define DRIFTMONITOR_H
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "opencv2/core/core.hpp"
+
+#include "options.hpp"
+#include "symbols.hpp"
+#include "warpmap.hpp"
+#include "graywarp.hpp"
+
+using namespace std;
+using namespace cv;
+
+
+
+/*
+  anchorTag
+  Structure describing a QR code fixed in the scene, whose position is known independently of the calibration
+*/
+struct anchorTag {
+  string data;      // Data encoded in the symbol, which may not be a number so that it is never taken for a Metabot
+  Point2f position; // Center of the symbol in the scene plane
+};
+
+
+
+/*
+  readAnchors
+  Function importing the anchor tags declared in a scene reference file
+  They are listed under Anchors, as { Data: "<data>", Position: [ <x>, <y> ] } maps
+    filename: input
+      Full path and name to the YML file to read
+    anchors: output
+      Declared anchor tags, empty if the scene declares none
+    Returns if the file could be read and every declared anchor is valid, with data that is not a Metabot number
+*/
+bool readAnchors(const char* filename, vector< anchorTag >& anchors);
+
+
+
+/*
+  DriftMonitor
+  Class checking the calibration against the anchor tags from a background thread, and correcting it when it drifts
+  The scan loop only adds the anchors' measured centers into running sums, and never waits for the monitor
+  Every period, the monitor compares their mean to the declared positions; past the threshold, it fits the correction
+  mapping the measured centers onto the declared ones, composes it with the current matrix and computes the new
+  reprojection tables, all on its own thread. The loop then picks the new matrix up between two frames
+  The correction is a homography with four anchors seen or more, a similarity with two or three
+*/
+class DriftMonitor
+{
+public:
+  /*
+    anchors: input
+      Anchor tags declared in the scene
+    M: input
+      Transformation matrix in use when the loop starts
+    scnsize: input
+      Dimensions of the scene, bounding the reprojected images
+    opts: input
+      Options of the run: opts.drift is the threshold in scene units, opts.driftperiod the period in seconds,
+      the reprojection options select the tables computed along with a new matrix
+  */
+  DriftMonitor(const vector< anchorTag >& anchors, const Mat& M, Size scnsize, const trackOptions& opts);
+  ~DriftMonitor();
+
+  /*
+    start
+    Function launching the monitoring thread
+    Returns if the thread could be launched, false when there is no anchor or no threshold
+  */
+  bool start();
+
+  /*
+    stop
+    Function stopping the monitoring thread and waiting for it to end
+  */
+  void stop();
+
+  /*
+    observe
+    Function adding the anchors found in a frame to the measures of the current period, never blocks
+    The frame is skipped when the monitor holds the measures
+      symbols: input
+        Symbols found in the frame, with their pose computed
+  */
+  void observe(const vector< qrSymbol >& symbols);
+
+  /*
+    retrieve
+    Function taking the corrected transformation over, never blocks
+    The measures gathered so far are discarded, since the following frames are reprojected differently
+      M: output
+        Corrected transformation matrix from the camera frame to the scene plane
+      warpmap: output
+        Reprojection tables already computed for M, as by Pipeline::prepareTables
+      graywarp: output
+        Single-pass reprojection already computed for M
+      Returns if a correction was pending, the outputs are left untouched otherwise
+  */
+  bool retrieve(Mat& M, Ptr< WarpMap >& warpmap, Ptr< GrayWarp >& graywarp);
+
+  // Number of checks made and of corrections computed, root mean square drift of the anchors at the last check
+  unsigned long getChecks();
+  unsigned long getCorrections();
+  float getDrift();
+
+private:
+  /*
+    correction
+    Function fitting the transformation of the scene plane mapping the measured centers onto the declared positions
+      measured: input
+        Mean measured centers of the anchors seen during the period
+      declared: input
+        Declared positions of the same anchors
+      C: output
+        3x3 correction matrix, CV_64F
+      Returns if there were enough anchors for a fit
+  */
+  static bool correction(const vector< Point2f >& measured, const vector< Point2f >& declared, Mat& C);
+
+  // Monitoring thread main loop
+  void watch();
+
+  vector< anchorTag > _anchors;
+  Mat _M; // Matrix the measures are made with, only used by the monitoring thread
+  Size _scnsize;
+  trackOptions _opts;
+  chrono::steady_clock::duration _period;
+
+  vector< Point2d > _sums; // Sum of the measured centers of each anchor during the current period
+  vector< int > _counts;   // Number of frames each anchor was seen in
+
+  Mat _nextM; // Correction computed and not taken over yet
+  Ptr< WarpMap > _nextWarpmap;
+  Ptr< GrayWarp > _nextGraywarp;
+  bool _pending;
+
+  thread _watchThread;
+  mutex _lock; // Guards the measures, the pending correction and the state below, never held while fitting or computing tables
+  condition_variable _stopCond; // Signaled when the thread must stop
+  bool _running;
+
+  unsigned long _checks, _corrections;
+  float _drift;
+};
+
+#endif // DRIFTMONITOR_H
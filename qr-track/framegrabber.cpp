@@ -0,0 +1,146 @@
+#include "framegrabber.hpp"
+
+
+
+FrameGrabber::FrameGrabber(FrameSource& source, bool lossless) :
+  _source(source),
+  _lossless(lossless),
+  _recorder(NULL),
+  _fresh(false),
+  _ended(false),
+  _running(false),
+  _captured(0),
+  _processed(0),
+  _dropped(0)
+{
+}
+
+
+
+FrameGrabber::~FrameGrabber()
+{
+  stop();
+}
+
+
+
+bool FrameGrabber::start()
+{
+  if (_running || !_source.isOpened())
+    return false;
+
+  _running = true;
+  _captureThread = thread(&FrameGrabber::capture, this);
+  return true;
+}
+
+
+
+void FrameGrabber::record(FrameRecorder* recorder)
+{
+  _recorder = recorder;
+}
+
+
+
+void FrameGrabber::stop()
+{
+  {
+    lock_guard<mutex> guard(_lock);
+    _running = false;
+  }
+  _freeCond.notify_all();
+
+  if (_captureThread.joinable())
+    _captureThread.join();
+}
+
+
+
+bool FrameGrabber::retrieve(Mat& frame)
+{
+  chrono::steady_clock::time_point stamp;
+  return retrieve(frame, stamp);
+}
+
+
+
+bool FrameGrabber::retrieve(Mat& frame, chrono::steady_clock::time_point& stamp)
+{
+  unique_lock<mutex> guard(_lock);
+  _readyCond.wait(guard, [this]{ return _fresh || _ended; });
+
+  if (!_fresh) // Source ended and every frame has been consumed
+    return false;
+
+  swap(frame, _ready); // Hand the latest frame over, get the consumer's old buffer back as a free slot
+  stamp = _readyStamp;
+  _fresh = false;
+  _processed++;
+
+  guard.unlock();
+  _freeCond.notify_one();
+  return true;
+}
+
+
+
+void FrameGrabber::capture()
+{
+  while (true) {
+    // Read outside of the lock, the consumer keeps working on its own slot meanwhile
+    bool frame_OK = _source.read(_back);
+    _backStamp = chrono::steady_clock::now(); // Read returns as soon as the frame is delivered
+    if (_recorder && frame_OK && _back.data) // Copied before the slot is handed over, the loop may drop the frame but the file keeps it
+      _recorder->record(_back, _backStamp);
+
+    unique_lock<mutex> guard(_lock);
+    if (! (_back.data && frame_OK) )
+      break;
+    _captured++;
+
+    if (_lossless)
+      _freeCond.wait(guard, [this]{ return !_fresh || !_running; });
+    if (!_running)
+      break;
+
+    if (_fresh) // The previous frame was never retrieved: latest frame wins
+      _dropped++;
+    swap(_back, _ready);
+    _readyStamp = _backStamp;
+    _fresh = true;
+
+    guard.unlock();
+    _readyCond.notify_one();
+  }
+
+  {
+    lock_guard<mutex> guard(_lock);
+    _ended = true;
+  }
+  _readyCond.notify_all();
+}
+
+
+
+unsigned long FrameGrabber::getCaptured()
+{
+  lock_guard<mutex> guard(_lock);
+  return _captured;
+}
+
+
+
+unsigned long FrameGrabber::getProcessed()
+{
+  lock_guard<mutex> guard(_lock);
+  return _processed;
+}
+
+
+
+unsigned long FrameGrabber::getDropped()
+{
+  lock_guard<mutex> guard(_lock);
+  return _dropped;
+}
@@ -0,0 +1,107 @@
+#ifndef FRAMEGRABBER_H
+#define FRAMEGRABBER_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "opencv2/core/core.hpp"
+
+#include "framesource.hpp"
+#include "framerecorder.hpp"
+
+using namespace std;
+using namespace cv;
+
+
+
+/*
+  FrameGrabber
+  Class reading a video source on a dedicated capture thread
+  Frames are exchanged through a ring of three preallocated slots:
+  the one being written by the capture thread, the latest complete frame, and the one held by the consumer
+  With a live camera the latest frame always wins: a complete frame that was not retrieved in time is overwritten and counted as dropped
+  With a lossless source (e.g. a video file) the capture thread waits for the consumer instead, so that no frame is skipped
+*/
+class FrameGrabber
+{
+public:
+  /*
+    source: input
+      Opened source to read from, owned by the caller
+    lossless: input
+      Whether the capture thread should wait for each frame to be retrieved instead of dropping it
+  */
+  FrameGrabber(FrameSource& source, bool lossless = false);
+  ~FrameGrabber();
+
+  /*
+    start
+    Function launching the capture thread
+    Returns if the thread could be launched
+  */
+  bool start();
+
+  /*
+    record
+    Function saving every frame read from the source, from the capture thread, before it is handed over
+    To be called before start, the recorder must be started and outlive the capture thread
+      recorder: input
+        Recorder to feed, NULL to stop recording
+  */
+  void record(FrameRecorder* recorder);
+
+  /*
+    stop
+    Function stopping the capture thread and waiting for it to end
+  */
+  void stop();
+
+  /*
+    retrieve
+    Function waiting for a frame newer than the last retrieved one
+      frame: output
+        Latest complete frame, exchanged with the ring without copy
+        The previous content of frame is given back to the ring as a free slot
+      Returns false if the source is exhausted or failed to deliver a frame
+  */
+  bool retrieve(Mat& frame);
+
+  /*
+    retrieve
+    Same as above, also giving the capture time of the frame
+      stamp: output
+        Time at which the frame was read from the source
+  */
+  bool retrieve(Mat& frame, chrono::steady_clock::time_point& stamp);
+
+  // Frame counters
+  unsigned long getCaptured();
+  unsigned long getProcessed();
+  unsigned long getDropped();
+
+private:
+  // Capture thread main loop
+  void capture();
+
+  FrameSource& _source;
+  bool _lossless;
+  FrameRecorder* _recorder; // Recorder fed by the capture thread, NULL if none
+
+  Mat _back;  // Slot being written by the capture thread
+  Mat _ready; // Latest complete frame, waiting to be retrieved
+  chrono::steady_clock::time_point _backStamp, _readyStamp; // Capture times of the two slots above
+
+  thread _captureThread;
+  mutex _lock; // Guards the slot exchange and the state below, never held while reading the source
+  condition_variable _readyCond; // Signaled when a new frame is ready or the source ended
+  condition_variable _freeCond;  // Signaled when the ready frame has been retrieved (lossless mode)
+  bool _fresh;   // The ready slot holds a frame not retrieved yet
+  bool _ended;   // The source failed or is exhausted
+  bool _running; // The capture thread should keep going
+
+  unsigned long _captured, _processed, _dropped;
+};
+
+#endif // FRAMEGRABBER_H
@@ -0,0 +1,197 @@
+#include <string.h>
+
+#include "framerecorder.hpp"
+
+
+
+FrameRecorder::FrameRecorder(const string& path, size_t chunkSize, int chunks) :
+  _path(path),
+  _file(NULL),
+  _chunkSize(chunkSize),
+  _chunks(max(chunks, 1)),
+  _laidOut(false),
+  _index(0),
+  _current(NULL),
+  _running(false),
+  _recorded(0),
+  _dropped(0),
+  _bytes(0)
+{
+  memset(&_header, 0, sizeof(_header));
+}
+
+
+
+FrameRecorder::~FrameRecorder()
+{
+  stop();
+}
+
+
+
+bool FrameRecorder::start()
+{
+  if (_running)
+    return false;
+
+  _file = fopen(_path.c_str(), "wb");
+  if (!_file)
+    return false;
+  setvbuf(_file, NULL, _IONBF, 0); // Chunks are large enough, they go straight to the disk without another copy
+
+  _running = true;
+  _writeThread = thread(&FrameRecorder::write, this);
+  return true;
+}
+
+
+
+void FrameRecorder::stop()
+{
+  if (!_running)
+    return;
+
+  {
+    lock_guard<mutex> guard(_lock);
+    if (_current && _current->used)
+      _full.push_back(_current);
+    _current = NULL;
+    _running = false;
+  }
+  _fullCond.notify_one();
+
+  if (_writeThread.joinable())
+    _writeThread.join();
+
+  fclose(_file);
+  _file = NULL;
+}
+
+
+
+void FrameRecorder::layout(const Mat& frame, clock::time_point stamp)
+{
+  size_t frameSize = frame.cols * frame.elemSize() * frame.rows;
+  size_t recordSize = (FRAMEFILE_ALIGN + frameSize + FRAMEFILE_ALIGN - 1) / FRAMEFILE_ALIGN * FRAMEFILE_ALIGN;
+
+  memcpy(_header.magic, FRAMEFILE_MAGIC, 8);
+  _header.width = frame.cols;
+  _header.height = frame.rows;
+  _header.type = frame.type();
+  _header.frameSize = frameSize;
+  _header.recordSize = recordSize;
+  _header.start = chrono::duration_cast< chrono::microseconds >(chrono::system_clock::now().time_since_epoch()).count();
+  _first = stamp;
+
+  // Written before any chunk is handed over, the writer thread only appends after it
+  uchar block[FRAMEFILE_ALIGN] = { 0 };
+  memcpy(block, &_header, sizeof(_header));
+  fwrite(block, 1, FRAMEFILE_ALIGN, _file);
+
+  size_t records = max< size_t >(_chunkSize / recordSize, 1);
+  _pool.resize(_chunks);
+  lock_guard<mutex> guard(_lock);
+  _bytes += FRAMEFILE_ALIGN;
+  for (size_t c = 0; c < _pool.size(); c++) {
+    _pool[c].data.assign(records * recordSize, 0);
+    _pool[c].used = 0;
+    _free.push_back(&_pool[c]);
+  }
+  _laidOut = true;
+}
+
+
+
+bool FrameRecorder::record(const Mat& frame, clock::time_point stamp)
+{
+  if (!_running || !frame.data)
+    return false;
+  if (!_laidOut)
+    layout(frame, stamp);
+  uint32_t index = _index++;
+
+  if ( (frame.cols != _header.width) || (frame.rows != _header.height) || (frame.type() != _header.type) ) {
+    lock_guard<mutex> guard(_lock);
+    _dropped++;
+    return false;
+  }
+
+  if (!_current) {
+    lock_guard<mutex> guard(_lock);
+    if (_free.empty()) { // Every chunk is waiting for the disk
+      _dropped++;
+      return false;
+    }
+    _current = _free.front();
+    _free.pop_front();
+    _current->used = 0;
+  }
+
+  // Copied outside of the lock, row by row since the frame may not be continuous
+  uchar* record = &_current->data[_current->used];
+  frameRecord header = { chrono::duration_cast< chrono::microseconds >(stamp - _first).count(), index, 0 };
+  memcpy(record, &header, sizeof(header));
+  size_t row = frame.cols * frame.elemSize();
+  for (int y = 0; y < frame.rows; y++)
+    memcpy(record + FRAMEFILE_ALIGN + y * row, frame.ptr(y), row);
+  _current->used += _header.recordSize;
+
+  bool full = (_current->used + _header.recordSize > _current->data.size());
+  {
+    lock_guard<mutex> guard(_lock);
+    _recorded++;
+    if (full) {
+      _full.push_back(_current);
+      _current = NULL;
+    }
+  }
+  if (full)
+    _fullCond.notify_one();
+  return true;
+}
+
+
+
+void FrameRecorder::write()
+{
+  unique_lock<mutex> guard(_lock);
+  while (true) {
+    _fullCond.wait(guard, [this]{ return !_full.empty() || !_running; });
+    if (_full.empty()) // Stopped and every chunk has been written
+      break;
+
+    chunk* c = _full.front();
+    _full.pop_front();
+
+    guard.unlock();
+    size_t written = fwrite(c->data.data(), 1, c->used, _file);
+    guard.lock();
+
+    _bytes += written;
+    _free.push_back(c);
+  }
+}
+
+
+
+unsigned long FrameRecorder::getRecorded()
+{
+  lock_guard<mutex> guard(_lock);
+  return _recorded;
+}
+
+
+
+unsigned long FrameRecorder::getDropped()
+{
+  lock_guard<mutex> guard(_lock);
+  return _dropped;
+}
+
+
+
+unsigned long FrameRecorder::getBytes()
+{
+  lock_guard<mutex> guard(_lock);
+  return _bytes;
+}
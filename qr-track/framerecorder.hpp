@@ -0,0 +1,147 @@
+#ifndef FRAMERECORDER_H
+#define FRAMERECORDER_H
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "opencv2/core/core.hpp"
+
+using namespace std;
+using namespace cv;
+
+
+
+/*
+  Frame files
+  Raw frames as delivered by a source, with their capture time, for bit-exact replays without decoding
+  The file is a 64-byte header followed by fixed-size records: a 64-byte record header, then the frame's pixels
+  Records are padded to a multiple of 64 bytes, so that frame N lies at a known offset and its pixels stay aligned once mapped
+  Every frame has the dimensions and type of the first one
+*/
+
+// Frame files start with this magic string
+#define FRAMEFILE_MAGIC "QRFRAMES"
+// Alignment of the file header, of the records and of their pixels
+#define FRAMEFILE_ALIGN 64
+
+/*
+  frameFileHeader
+  Structure of the file header, written as is in the host byte order and padded to FRAMEFILE_ALIGN bytes
+*/
+struct frameFileHeader {
+  char magic[8];       // FRAMEFILE_MAGIC
+  int32_t width;       // Dimensions of the frames
+  int32_t height;
+  int32_t type;        // OpenCV type of the frames, CV_8UC3 for BGR or CV_8UC1 for luma
+  uint32_t frameSize;  // Bytes of pixels in a frame, rows stored without padding
+  uint32_t recordSize; // Bytes between the starts of two records
+  uint32_t reserved;
+  int64_t start;       // System time at which the first frame was captured, in microseconds since the epoch
+};
+
+/*
+  frameRecord
+  Structure of a record header, written as is in the host byte order and padded to FRAMEFILE_ALIGN bytes
+*/
+struct frameRecord {
+  int64_t stamp;  // Capture time of the frame, in microseconds since the first frame
+  uint32_t index; // Index of the frame among the captured ones, gaps show frames dropped by the recorder
+  uint32_t reserved;
+};
+
+
+
+/*
+  FrameRecorder
+  Class saving raw frames into a frame file without slowing the capture down
+  Frames are copied into large chunks, which a writer thread appends to the file in single sequential writes
+  When every chunk is waiting for the disk, frames are dropped and counted instead of making the capture wait
+*/
+class FrameRecorder
+{
+public:
+  typedef chrono::steady_clock clock;
+
+  /*
+    path: input
+      Frame file to write, created or truncated
+    chunkSize: input
+      Bytes of frames gathered before each write, at least one frame
+    chunks: input
+      Number of chunks, that is of writes that may be pending before frames are dropped
+  */
+  FrameRecorder(const string& path, size_t chunkSize = 16 << 20, int chunks = 4);
+  ~FrameRecorder();
+
+  /*
+    start
+    Function opening the file and launching the writer thread
+    Returns if the file could be opened and the thread launched
+  */
+  bool start();
+
+  /*
+    stop
+    Function writing the frames still in memory, then stopping the writer thread and closing the file
+    No frame may be recorded concurrently
+  */
+  void stop();
+
+  /*
+    record
+    Function copying a frame for the writer thread, from a single thread, usually the capture one
+      frame: input
+        Frame to save, of the dimensions and type of the first one
+      stamp: input
+        Capture time of the frame
+      Returns false if the frame was dropped
+  */
+  bool record(const Mat& frame, clock::time_point stamp);
+
+  // Counters: frames saved or waiting to be, frames dropped, bytes written so far
+  unsigned long getRecorded();
+  unsigned long getDropped();
+  unsigned long getBytes();
+
+private:
+  struct chunk {
+    vector< uchar > data;
+    size_t used;
+  };
+
+  // Function laying the file out after the first frame
+  void layout(const Mat& frame, clock::time_point stamp);
+
+  // Writer thread main loop
+  void write();
+
+  string _path;
+  FILE* _file;
+  size_t _chunkSize;
+  int _chunks;
+
+  frameFileHeader _header; // Set from the first frame
+  bool _laidOut;
+  clock::time_point _first;
+  uint32_t _index;
+
+  chunk* _current; // Chunk being filled by the recording thread, NULL if none was free
+  vector< chunk > _pool;
+  deque< chunk* > _free, _full;
+
+  thread _writeThread;
+  mutex _lock; // Guards the two queues and the counters, never held while copying or writing
+  condition_variable _fullCond;
+  bool _running;
+
+  unsigned long _recorded, _dropped, _bytes;
+};
+
+#endif // FRAMERECORDER_H
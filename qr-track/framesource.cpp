@@ -0,0 +1,270 @@
+#include <sstream>
+#include <thread>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include "framesource.hpp"
+#include "framerecorder.hpp"
+
+
+
+CaptureSource::CaptureSource(int index, bool luma) :
+  _videocap(index),
+  _live(true),
+  _luma(luma)
+{
+  // Ask for the frames as captured, YUYV for most webcams, instead of converted to BGR
+  // Backends that do not support it keep converting, read() then falls back to a grayscale conversion
+  if (_luma && _videocap.isOpened()) {
+    _videocap.set(CV_CAP_PROP_CONVERT_RGB, 0);
+    _size = Size((int) _videocap.get(CV_CAP_PROP_FRAME_WIDTH), (int) _videocap.get(CV_CAP_PROP_FRAME_HEIGHT));
+  }
+}
+
+
+
+CaptureSource::CaptureSource(const string& path, bool luma) :
+  _videocap(path),
+  _live(false),
+  _luma(luma)
+{
+}
+
+
+
+bool CaptureSource::isOpened() const
+{
+  return _videocap.isOpened();
+}
+
+
+
+bool CaptureSource::isLive() const
+{
+  return _live;
+}
+
+
+
+bool CaptureSource::read(Mat& frame)
+{
+  if (!_luma)
+    return _videocap.read(frame) && frame.data;
+
+  if (! (_videocap.read(_decoded) && _decoded.data) )
+    return false;
+
+  // A plane of the announced dimensions, a single row or other dimensions being a compressed buffer
+  bool image = (_size.area() > 0) ? (_decoded.size() == _size) : (_decoded.rows > 1);
+
+  if ( (_decoded.type() == CV_8UC1) && image ) // Already a single plane
+    swap(frame, _decoded);
+  else if ( (_decoded.type() == CV_8UC2) && image ) { // Packed YUYV: luma is every other byte
+    frame.create(_decoded.size(), CV_8UC1);
+    int fromTo[] = { 0, 0 };
+    mixChannels(&_decoded, 1, &frame, 1, fromTo, 1);
+  }
+  else if (_decoded.channels() >= 3) // Decoded to BGR by the backend
+    cvtColor(_decoded, frame, CV_BGR2GRAY);
+  else {
+    // Compressed buffer, MJPEG for instance: decoded straight to grayscale, the backend converts the next frames to BGR again
+    frame = imdecode(_decoded, CV_LOAD_IMAGE_GRAYSCALE);
+    _videocap.set(CV_CAP_PROP_CONVERT_RGB, 1);
+    return frame.data != NULL;
+  }
+  return true;
+}
+
+
+
+Y4MSource::Y4MSource(const string& path) :
+  _file(path.c_str(), ios::in | ios::binary),
+  _opened(false),
+  _chroma(0)
+{
+  string header;
+  if (! (_file.is_open() && getline(_file, header)) )
+    return;
+
+  // "YUV4MPEG2 W<width> H<height> [F.. I.. A..] [C<colorspace>] [X..]"
+  istringstream fields(header);
+  string field, colorspace("420jpeg");
+  fields >> field;
+  if (field != "YUV4MPEG2")
+    return;
+  while (fields >> field) {
+    if (field[0] == 'W')
+      _size.width = atoi(field.c_str() + 1);
+    else if (field[0] == 'H')
+      _size.height = atoi(field.c_str() + 1);
+    else if (field[0] == 'C')
+      colorspace = field.substr(1);
+  }
+  if ( (_size.width <= 0) || (_size.height <= 0) )
+    return;
+
+  // Only 8-bit samples, higher depths are tagged with a depth suffix (e.g. 420p10), 4:2:0 chroma siting does not matter
+  streamoff w = _size.width, h = _size.height, cw = (w + 1) / 2, ch = (h + 1) / 2;
+  if ( (colorspace == "420") || (colorspace == "420jpeg") || (colorspace == "420paldv") || (colorspace == "420mpeg2") )
+    _chroma = 2 * cw * ch;
+  else if (colorspace == "422")
+    _chroma = 2 * cw * h;
+  else if (colorspace == "444")
+    _chroma = 2 * w * h;
+  else if (colorspace == "444alpha")
+    _chroma = 3 * w * h;
+  else if (colorspace == "mono")
+    _chroma = 0;
+  else
+    return;
+
+  _opened = true;
+}
+
+
+
+bool Y4MSource::isOpened() const
+{
+  return _opened;
+}
+
+
+
+bool Y4MSource::isLive() const
+{
+  return false;
+}
+
+
+
+bool Y4MSource::read(Mat& frame)
+{
+  if (!_opened)
+    return false;
+
+  // Each frame starts with a "FRAME[ parameters]" line
+  string tag;
+  if (! getline(_file, tag) || (tag.compare(0, 5, "FRAME") != 0) )
+    return false;
+
+  frame.create(_size, CV_8UC1); // Continuous, so that the plane is read in one go
+  _file.read((char*) frame.data, (streamsize) _size.area());
+  _file.seekg(_chroma, ios::cur);
+
+  return _file.good();
+}
+
+
+
+ReplaySource::ReplaySource(const string& path, bool realtime) :
+  _realtime(realtime),
+  _data(NULL),
+  _bytes(0),
+  _type(0),
+  _recordSize(0),
+  _frames(0),
+  _next(0)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+
+  struct stat st;
+  if ( (fstat(fd, &st) == 0) && (st.st_size >= FRAMEFILE_ALIGN) ) {
+    // Private mapping: pages are shared with the page cache, and copied only if a stage writes into a frame
+    void* data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      _data = (uchar*) data;
+      _bytes = st.st_size;
+    }
+  }
+  close(fd);
+  if (!_data)
+    return;
+
+  frameFileHeader header;
+  memcpy(&header, _data, sizeof(header));
+  bool valid = (memcmp(header.magic, FRAMEFILE_MAGIC, 8) == 0) && (header.width > 0) && (header.height > 0)
+    && ( (header.type == CV_8UC1) || (header.type == CV_8UC3) )
+    && (header.frameSize == header.width * header.height * (header.type == CV_8UC3 ? 3u : 1u))
+    && (header.recordSize >= FRAMEFILE_ALIGN + header.frameSize) && (header.recordSize % FRAMEFILE_ALIGN == 0);
+  if (!valid) {
+    munmap(_data, _bytes);
+    _data = NULL;
+    return;
+  }
+
+  _size = Size(header.width, header.height);
+  _type = header.type;
+  _recordSize = header.recordSize;
+  _frames = (_bytes - FRAMEFILE_ALIGN) / _recordSize; // A truncated last record is ignored
+  madvise(_data, _bytes, MADV_SEQUENTIAL);
+}
+
+
+
+ReplaySource::~ReplaySource()
+{
+  if (_data)
+    munmap(_data, _bytes);
+}
+
+
+
+bool ReplaySource::isOpened() const
+{
+  return _data != NULL;
+}
+
+
+
+bool ReplaySource::isLive() const
+{
+  return _realtime;
+}
+
+
+
+bool ReplaySource::read(Mat& frame)
+{
+  if ( !_data || (_next >= _frames) )
+    return false;
+
+  uchar* record = _data + FRAMEFILE_ALIGN + _next * _recordSize;
+  if (_realtime) { // Wait for the capture time of the frame, relative to the first one read
+    frameRecord header;
+    memcpy(&header, record, sizeof(header));
+    if (_next == 0)
+      _begin = chrono::steady_clock::now() - chrono::microseconds(header.stamp);
+    this_thread::sleep_until(_begin + chrono::microseconds(header.stamp));
+  }
+  _next++;
+
+  frame = Mat(_size, _type, record + FRAMEFILE_ALIGN); // Header on the mapped pixels, the previous buffer is released
+  return true;
+}
+
+
+
+size_t ReplaySource::getFrames() const
+{
+  return _frames;
+}
+
+
+
+Ptr< FrameSource > openFileSource(const string& path, bool luma)
+{
+  string ext = path.substr(path.find_last_of(".") + 1);
+  if (ext == "y4m")
+    return new Y4MSource(path);
+  if (ext == "qrf")
+    return new ReplaySource(path);
+  return new CaptureSource(path, luma);
+}
@@ -0,0 +1,162 @@
+#ifndef FRAMESOURCE_H
+#define FRAMESOURCE_H
+
+#include <string>
+#include <fstream>
+#include <chrono>
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/highgui/highgui.hpp"
+
+using namespace std;
+using namespace cv;
+
+
+
+/*
+  FrameSource
+  Interface of the video sources feeding the tracker
+  A source delivers either BGR frames, or only their 8-bit luma plane, which is all the scanner needs
+  The pipeline accepts both, a luma frame skips the grayscale conversion and is reprojected on a single channel
+*/
+class FrameSource
+{
+public:
+  virtual ~FrameSource() {}
+
+  // Whether the source could be opened
+  virtual bool isOpened() const = 0;
+
+  // Whether the source is a live camera, whose frames may be dropped, rather than a file to be read entirely
+  virtual bool isLive() const = 0;
+
+  /*
+    read
+    Function reading the next frame
+      frame: output
+        Next frame, CV_8UC3 BGR or CV_8UC1 luma, its previous buffer is reused when possible
+      Returns false if the source failed or is exhausted
+  */
+  virtual bool read(Mat& frame) = 0;
+};
+
+
+
+/*
+  CaptureSource
+  Source reading a camera or a video file through OpenCV's VideoCapture
+  In luma mode, cameras are asked for their native YUV frames, whose Y channel is extracted without color conversion
+  When the backend only decodes to BGR, the luma plane is computed on the capture thread, off the scan loop
+  A backend honoring the request for a compressed stream, MJPEG for instance, hands the compressed buffer over:
+  it is decoded straight to grayscale, and the conversion is asked for again for the next frames
+*/
+class CaptureSource : public FrameSource
+{
+public:
+  /*
+    index: input
+      Index of the camera to open
+    luma: input
+      Whether to deliver the luma plane only
+  */
+  CaptureSource(int index, bool luma);
+
+  /*
+    path: input
+      Full path and name to the video file to open
+    luma: input
+      Whether to deliver the luma plane only
+  */
+  CaptureSource(const string& path, bool luma);
+
+  bool isOpened() const;
+  bool isLive() const;
+  bool read(Mat& frame);
+
+private:
+  VideoCapture _videocap;
+  bool _live;
+  bool _luma;
+  Size _size;   // Dimensions of the frames announced by the backend, empty if unknown
+  Mat _decoded; // Frame as delivered by the backend, in luma mode
+};
+
+
+
+/*
+  Y4MSource
+  Source reading a YUV4MPEG2 (.y4m) file with 8-bit samples, as written by ffmpeg or mjpegtools
+  Always delivers the luma plane: it is read straight from the file and the chroma planes are skipped
+*/
+class Y4MSource : public FrameSource
+{
+public:
+  /*
+    path: input
+      Full path and name to the Y4M file to open
+  */
+  Y4MSource(const string& path);
+
+  bool isOpened() const;
+  bool isLive() const;
+  bool read(Mat& frame);
+
+private:
+  ifstream _file;
+  bool _opened;
+  Size _size;           // Dimensions of the luma plane
+  streamoff _chroma;    // Bytes of chroma and alpha following the luma plane of each frame
+};
+
+
+
+/*
+  ReplaySource
+  Source replaying a frame file saved by FrameRecorder, as captured: bit-exact and without any decoding
+  The file is mapped in memory and each frame is handed over as a header on the mapped pixels, without copy
+  Frames are delivered as fast as they are read, or at the pace they were captured, in which case the source behaves as a live camera
+*/
+class ReplaySource : public FrameSource
+{
+public:
+  /*
+    path: input
+      Full path and name to the frame file to open
+    realtime: input
+      Whether to deliver each frame at its capture time instead of as fast as possible
+  */
+  ReplaySource(const string& path, bool realtime = false);
+  ~ReplaySource();
+
+  bool isOpened() const;
+  bool isLive() const;
+  bool read(Mat& frame);
+
+  // Number of frames in the file
+  size_t getFrames() const;
+
+private:
+  bool _realtime;
+  uchar* _data;  // Mapped file, NULL if it could not be opened
+  size_t _bytes; // Size of the mapping
+  Size _size;
+  int _type;
+  size_t _recordSize;
+  size_t _frames, _next; // Number of frames, index of the next one to read
+  chrono::steady_clock::time_point _begin; // Time at which the first frame was read, in real-time mode
+};
+
+
+
+/*
+  openFileSource
+  Function opening a video file with the source matching its extension
+    path: input
+      Full path and name to a Y4M file, a frame file saved by FrameRecorder (.qrf), or to any video file VideoCapture can read
+    luma: input
+      Whether to deliver the luma plane only, Y4M files always do, frame files deliver the frames as recorded
+    Returns the source, check isOpened
+*/
+Ptr< FrameSource > openFileSource(const string& path, bool luma);
+
+#endif // FRAMESOURCE_H
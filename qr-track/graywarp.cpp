@@ -0,0 +1,394 @@
+#include <string.h>
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include "graywarp.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GRAYWARP_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define GRAYWARP_NEON
+#include <arm_neon.h>
+#endif
+
+// Luma weights of cvtColor(CV_BGR2GRAY), in 1/16384
+#define YB 1868
+#define YG 9617
+#define YR 4899
+
+
+
+/*
+  Integer arithmetic shared by every kernel:
+  luma is computed on each neighbor with 8 fractional bits, then interpolated with 5-bit fractions in both directions
+  The result is rounded with 18 fractional bits, intermediate values stay below 2^27
+*/
+static inline int lumaOf(const uchar* p)
+{
+  return (p[0] * YB + p[1] * YG + p[2] * YR + 32) >> 6;
+}
+
+static inline uchar interpolate(int g00, int g01, int g10, int g11, int frac)
+{
+  int fx = frac & 31, fy = frac >> 5;
+  int top = g00 * 32 + (g01 - g00) * fx;
+  int bottom = g10 * 32 + (g11 - g10) * fx;
+  return (uchar) ((top * 32 + (bottom - top) * fy + (1 << 17)) >> 18);
+}
+
+
+
+/*
+  warpBorder
+  Reference kernel for one pixel, neighbors outside of the frame count as black like warpPerspective's constant border
+*/
+static inline uchar warpBorder(const Mat& src, int x0, int y0, int frac)
+{
+  int g[4];
+  for (int n = 0; n < 4; n++) {
+    int x = x0 + (n & 1), y = y0 + (n >> 1);
+    bool inside = (x >= 0) && (y >= 0) && (x < src.cols) && (y < src.rows);
+    g[n] = inside ? lumaOf(src.ptr<uchar>(y) + 3 * x) : 0;
+  }
+  return interpolate(g[0], g[1], g[2], g[3], frac);
+}
+
+
+
+/*
+  warpSpanScalar
+  Reference kernel for n interior pixels: every neighbor lies within the frame
+*/
+static void warpSpanScalar(const uchar* src, size_t step, const int* offsets, const ushort* frac, uchar* dst, int n)
+{
+  for (int i = 0; i < n; i++) {
+    const uchar* p = src + offsets[i];
+    dst[i] = interpolate(lumaOf(p), lumaOf(p + 3), lumaOf(p + step), lumaOf(p + step + 3), frac[i]);
+  }
+}
+
+
+
+#ifdef GRAYWARP_X86
+
+/*
+  Interior spans are built so that reading four bytes at every neighbor stays within the frame:
+  the fourth byte is the blue channel of the next pixel, ignored by the masks below
+*/
+static inline int load32(const uchar* p)
+{
+  int v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i lumaAVX2(__m256i p)
+{
+  const __m256i mask = _mm256_set1_epi32(0x00FF00FF);
+  __m256i br = _mm256_and_si256(p, mask);                        // Blue and red in 16-bit lanes
+  __m256i gx = _mm256_and_si256(_mm256_srli_epi32(p, 8), mask);  // Green and the next pixel's blue
+  __m256i v = _mm256_add_epi32(_mm256_madd_epi16(br, _mm256_set1_epi32((YR << 16) | YB)),
+                               _mm256_madd_epi16(gx, _mm256_set1_epi32(YG)));
+  return _mm256_srli_epi32(_mm256_add_epi32(v, _mm256_set1_epi32(32)), 6);
+}
+
+__attribute__((target("avx2")))
+static void warpSpanAVX2(const uchar* src, size_t step, const int* offsets, const ushort* frac, uchar* dst, int n)
+{
+  const int* s00 = (const int*) src;
+  const int* s01 = (const int*) (src + 3);
+  const int* s10 = (const int*) (src + step);
+  const int* s11 = (const int*) (src + step + 3);
+  const __m256i thirtytwo = _mm256_set1_epi32(32), round = _mm256_set1_epi32(1 << 17);
+  const __m256i gather = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i off = _mm256_loadu_si256((const __m256i*) (offsets + i));
+    __m256i g00 = lumaAVX2(_mm256_i32gather_epi32(s00, off, 1));
+    __m256i g01 = lumaAVX2(_mm256_i32gather_epi32(s01, off, 1));
+    __m256i g10 = lumaAVX2(_mm256_i32gather_epi32(s10, off, 1));
+    __m256i g11 = lumaAVX2(_mm256_i32gather_epi32(s11, off, 1));
+
+    __m256i f = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*) (frac + i)));
+    __m256i fx = _mm256_and_si256(f, _mm256_set1_epi32(31)), fy = _mm256_srli_epi32(f, 5);
+
+    __m256i top = _mm256_add_epi32(_mm256_mullo_epi32(g00, thirtytwo), _mm256_mullo_epi32(_mm256_sub_epi32(g01, g00), fx));
+    __m256i bottom = _mm256_add_epi32(_mm256_mullo_epi32(g10, thirtytwo), _mm256_mullo_epi32(_mm256_sub_epi32(g11, g10), fx));
+    __m256i v = _mm256_add_epi32(_mm256_mullo_epi32(top, thirtytwo), _mm256_mullo_epi32(_mm256_sub_epi32(bottom, top), fy));
+    v = _mm256_srli_epi32(_mm256_add_epi32(v, round), 18);
+
+    // Narrow to bytes: each 128-bit lane packs its four results, gather both lanes in the low 64 bits
+    v = _mm256_packus_epi32(v, v);
+    v = _mm256_packus_epi16(v, v);
+    v = _mm256_permutevar8x32_epi32(v, gather);
+    _mm_storel_epi64((__m128i*) (dst + i), _mm256_castsi256_si128(v));
+  }
+
+  warpSpanScalar(src, step, offsets + i, frac + i, dst + i, n - i);
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i lumaSSE(__m128i p)
+{
+  const __m128i mask = _mm_set1_epi32(0x00FF00FF);
+  __m128i br = _mm_and_si128(p, mask);
+  __m128i gx = _mm_and_si128(_mm_srli_epi32(p, 8), mask);
+  __m128i v = _mm_add_epi32(_mm_madd_epi16(br, _mm_set1_epi32((YR << 16) | YB)),
+                            _mm_madd_epi16(gx, _mm_set1_epi32(YG)));
+  return _mm_srli_epi32(_mm_add_epi32(v, _mm_set1_epi32(32)), 6);
+}
+
+__attribute__((target("sse4.1")))
+static void warpSpanSSE41(const uchar* src, size_t step, const int* offsets, const ushort* frac, uchar* dst, int n)
+{
+  const __m128i thirtytwo = _mm_set1_epi32(32), round = _mm_set1_epi32(1 << 17);
+
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    // No gather instruction before AVX2: the neighbors are loaded one by one
+    const uchar* p0 = src + offsets[i];
+    const uchar* p1 = src + offsets[i + 1];
+    const uchar* p2 = src + offsets[i + 2];
+    const uchar* p3 = src + offsets[i + 3];
+    __m128i g00 = lumaSSE(_mm_setr_epi32(load32(p0), load32(p1), load32(p2), load32(p3)));
+    __m128i g01 = lumaSSE(_mm_setr_epi32(load32(p0 + 3), load32(p1 + 3), load32(p2 + 3), load32(p3 + 3)));
+    __m128i g10 = lumaSSE(_mm_setr_epi32(load32(p0 + step), load32(p1 + step), load32(p2 + step), load32(p3 + step)));
+    __m128i g11 = lumaSSE(_mm_setr_epi32(load32(p0 + step + 3), load32(p1 + step + 3), load32(p2 + step + 3), load32(p3 + step + 3)));
+
+    __m128i f = _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*) (frac + i)));
+    __m128i fx = _mm_and_si128(f, _mm_set1_epi32(31)), fy = _mm_srli_epi32(f, 5);
+
+    __m128i top = _mm_add_epi32(_mm_mullo_epi32(g00, thirtytwo), _mm_mullo_epi32(_mm_sub_epi32(g01, g00), fx));
+    __m128i bottom = _mm_add_epi32(_mm_mullo_epi32(g10, thirtytwo), _mm_mullo_epi32(_mm_sub_epi32(g11, g10), fx));
+    __m128i v = _mm_add_epi32(_mm_mullo_epi32(top, thirtytwo), _mm_mullo_epi32(_mm_sub_epi32(bottom, top), fy));
+    v = _mm_srli_epi32(_mm_add_epi32(v, round), 18);
+
+    v = _mm_packus_epi32(v, v);
+    v = _mm_packus_epi16(v, v);
+    *(int*) (dst + i) = _mm_cvtsi128_si32(v);
+  }
+
+  warpSpanScalar(src, step, offsets + i, frac + i, dst + i, n - i);
+}
+
+#endif // GRAYWARP_X86
+
+
+
+#ifdef GRAYWARP_NEON
+
+static inline int32x4_t lumaNEON(const uchar* p0, const uchar* p1, const uchar* p2, const uchar* p3)
+{
+  int32x4_t b = { p0[0], p1[0], p2[0], p3[0] };
+  int32x4_t g = { p0[1], p1[1], p2[1], p3[1] };
+  int32x4_t r = { p0[2], p1[2], p2[2], p3[2] };
+  int32x4_t v = vmlaq_n_s32(vmlaq_n_s32(vmulq_n_s32(b, YB), g, YG), r, YR);
+  return vshrq_n_s32(vaddq_s32(v, vdupq_n_s32(32)), 6);
+}
+
+static void warpSpanNEON(const uchar* src, size_t step, const int* offsets, const ushort* frac, uchar* dst, int n)
+{
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const uchar* p0 = src + offsets[i];
+    const uchar* p1 = src + offsets[i + 1];
+    const uchar* p2 = src + offsets[i + 2];
+    const uchar* p3 = src + offsets[i + 3];
+    int32x4_t g00 = lumaNEON(p0, p1, p2, p3);
+    int32x4_t g01 = lumaNEON(p0 + 3, p1 + 3, p2 + 3, p3 + 3);
+    int32x4_t g10 = lumaNEON(p0 + step, p1 + step, p2 + step, p3 + step);
+    int32x4_t g11 = lumaNEON(p0 + step + 3, p1 + step + 3, p2 + step + 3, p3 + step + 3);
+
+    int32x4_t f = vreinterpretq_s32_u32(vmovl_u16(vld1_u16(frac + i)));
+    int32x4_t fx = vandq_s32(f, vdupq_n_s32(31)), fy = vshrq_n_s32(f, 5);
+
+    int32x4_t top = vmlaq_s32(vshlq_n_s32(g00, 5), vsubq_s32(g01, g00), fx);
+    int32x4_t bottom = vmlaq_s32(vshlq_n_s32(g10, 5), vsubq_s32(g11, g10), fx);
+    int32x4_t v = vmlaq_s32(vshlq_n_s32(top, 5), vsubq_s32(bottom, top), fy);
+    v = vshrq_n_s32(vaddq_s32(v, vdupq_n_s32(1 << 17)), 18);
+
+    uint16x4_t narrow = vqmovun_s32(v);
+    uint8x8_t bytes = vqmovn_u16(vcombine_u16(narrow, narrow));
+    vst1_lane_u32((uint32_t*) (dst + i), vreinterpret_u32_u8(bytes), 0);
+  }
+
+  warpSpanScalar(src, step, offsets + i, frac + i, dst + i, n - i);
+}
+
+#endif // GRAYWARP_NEON
+
+
+
+typedef void (*warpSpanKernel)(const uchar*, size_t, const int*, const ushort*, uchar*, int);
+
+/*
+  bestKernel
+  Function picking the fastest kernel supported by the CPU running the program
+*/
+static warpSpanKernel bestKernel(const char** name)
+{
+#ifdef GRAYWARP_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    *name = "avx2";
+    return warpSpanAVX2;
+  }
+  if (__builtin_cpu_supports("sse4.1")) {
+    *name = "sse4.1";
+    return warpSpanSSE41;
+  }
+#endif
+#ifdef GRAYWARP_NEON
+  *name = "neon";
+  return warpSpanNEON;
+#endif
+  *name = "scalar";
+  return warpSpanScalar;
+}
+
+static const char* kernel_name = "scalar";
+static const warpSpanKernel kernel = bestKernel(&kernel_name);
+
+
+
+/*
+  WarpGrayStripes
+  Loop body reprojecting a range of row stripes of the scene
+*/
+class WarpGrayStripes : public ParallelLoopBody
+{
+public:
+  WarpGrayStripes(const Mat& src, Mat& dst, const Mat& map, const Mat& frac, const vector< int >& offsets, const vector< Range >& spans, warpSpanKernel span, int nstripes) :
+    _src(src), _dst(dst), _map(map), _frac(frac), _offsets(offsets), _spans(spans), _span(span), _nstripes(nstripes) {}
+
+  void operator()(const Range& range) const
+  {
+    int rows = _dst.rows, cols = _dst.cols;
+    int y0 = rows * range.start / _nstripes, y1 = rows * range.end / _nstripes;
+
+    for (int y = y0; y < y1; y++) {
+      const short* map = _map.ptr<short>(y);
+      const ushort* frac = _frac.ptr<ushort>(y);
+      uchar* dst = _dst.ptr<uchar>(y);
+      const Range& span = _spans[y];
+
+      for (int x = 0; x < span.start; x++)
+        dst[x] = warpBorder(_src, map[2 * x], map[2 * x + 1], frac[x]);
+
+      _span(_src.data, _src.step, &_offsets[(size_t) y * cols + span.start], frac + span.start, dst + span.start, span.size());
+
+      for (int x = span.end; x < cols; x++)
+        dst[x] = warpBorder(_src, map[2 * x], map[2 * x + 1], frac[x]);
+    }
+  }
+
+private:
+  const Mat& _src;
+  Mat& _dst;
+  const Mat& _map;
+  const Mat& _frac;
+  const vector< int >& _offsets;
+  const vector< Range >& _spans;
+  warpSpanKernel _span;
+  int _nstripes;
+};
+
+
+
+GrayWarp::GrayWarp(const Mat& M, Size scnsize, int nstripes) :
+  _size(scnsize),
+  _nstripes(nstripes > 0 ? nstripes : getNumberOfCPUs())
+{
+  // Same inverse mapping as warpPerspective, rounded to 1/32 of pixel like its fixed-point tables
+  Mat Minv;
+  M.convertTo(Minv, CV_64F);
+  Minv = Minv.inv();
+  const double* m = Minv.ptr<double>();
+
+  Mat map(scnsize, CV_32FC2);
+  for (int y = 0; y < scnsize.height; y++) {
+    float* row = map.ptr<float>(y);
+    for (int x = 0; x < scnsize.width; x++) {
+      double w = m[6] * x + m[7] * y + m[8];
+      w = (w != 0. ? 1. / w : 0.);
+      double sx = (m[0] * x + m[1] * y + m[2]) * w, sy = (m[3] * x + m[4] * y + m[5]) * w;
+      if (w == 0.) // Point at infinity, left outside of the source image
+        sx = sy = -1.;
+      row[2 * x] = (float) sx;
+      row[2 * x + 1] = (float) sy;
+    }
+  }
+
+  convertMaps(map, Mat(), _map, _frac, CV_16SC2);
+}
+
+
+
+shared_ptr< const GrayWarp::srcLayout > GrayWarp::layout(const Mat& src) const
+{
+  shared_ptr< srcLayout > l(new srcLayout);
+  l->srcsize = src.size();
+  l->srcstep = src.step;
+  l->offsets.assign((size_t) _size.area(), 0);
+  l->spans.assign(_size.height, Range(0, 0));
+
+  for (int y = 0; y < _size.height; y++) {
+    const short* map = _map.ptr<short>(y);
+    int* offsets = &l->offsets[(size_t) y * _size.width];
+    int first = -1, last = -1;
+    bool contiguous = true;
+
+    // Interior pixels: both neighbor rows exist and four bytes can be read at the right neighbor
+    for (int x = 0; x < _size.width; x++) {
+      int x0 = map[2 * x], y0 = map[2 * x + 1];
+      bool inside = (x0 >= 0) && (y0 >= 0) && (x0 + 2 < src.cols) && (y0 + 1 < src.rows);
+      if (!inside)
+        continue;
+
+      offsets[x] = (int) (y0 * src.step + 3 * x0);
+      if (first < 0)
+        first = x;
+      else if (last != x - 1)
+        contiguous = false;
+      last = x;
+    }
+
+    // The frame projects to a convex quadrilateral, so the interior of a row is a single run
+    // Should rounding break it, the whole row takes the bounds-checked path
+    if ( (first >= 0) && contiguous )
+      l->spans[y] = Range(first, last + 1);
+  }
+
+  return l;
+}
+
+
+
+void GrayWarp::apply(const Mat& src, Mat& dst, bool reference)
+{
+  CV_Assert(src.type() == CV_8UC3);
+
+  shared_ptr< const srcLayout > l;
+  {
+    lock_guard<mutex> guard(_layoutLock); // Frames of a single stream share their layout, it is computed once
+    if ( !_layout || (src.size() != _layout->srcsize) || (src.step != _layout->srcstep) )
+      _layout = layout(src);
+    l = _layout;
+  }
+
+  dst.create(_size, CV_8UC1);
+  warpSpanKernel span = reference ? warpSpanScalar : kernel;
+  parallel_for_(Range(0, _nstripes), WarpGrayStripes(src, dst, _map, _frac, l->offsets, l->spans, span, _nstripes), _nstripes);
+}
+
+
+
+const char* GrayWarp::kernelName()
+{
+  return kernel_name;
+}
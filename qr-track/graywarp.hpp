@@ -0,0 +1,79 @@
+#ifndef GRAYWARP_H
+#define GRAYWARP_H
+
+#include <vector>
+#include <memory>
+#include <mutex>
+
+#include "opencv2/core/core.hpp"
+
+using namespace std;
+using namespace cv;
+
+
+
+/*
+  GrayWarp
+  Class reprojecting a BGR camera frame straight into a grayscale scene, in a single pass
+  Each scene pixel samples its four source neighbors through the precomputed transformation,
+  converts them to luma and interpolates them: no color scene is ever written
+  The kernel is vectorized for AVX2 and SSE4.1 on x86, and NEON on ARM, the best one is picked at run time
+  Every kernel uses the same integer arithmetic as the scalar reference, so their results are identical
+  Compared to warpPerspective followed by cvtColor, each pixel may differ by one gray level due to rounding
+  A single instance may reproject frames from several threads at once
+*/
+class GrayWarp
+{
+public:
+  /*
+    M: input
+      Transformation matrix from the camera frame to the scene plane, as loaded by readProj
+    scnsize: input
+      Dimensions of the scene, bounding the reprojected images
+    nstripes: input
+      Number of row stripes processed in parallel, 0 to use one per CPU
+  */
+  GrayWarp(const Mat& M, Size scnsize, int nstripes = 0);
+
+  /*
+    apply
+    Function reprojecting a frame into the grayscale scene
+      src: input
+        BGR camera frame, CV_8UC3
+      dst: output
+        Grayscale scene, continuous CV_8UC1 with the dimensions of the scene, ready to be wrapped as a Y800 image
+      reference: input
+        Whether to use the scalar reference kernel instead of the fastest one available
+  */
+  void apply(const Mat& src, Mat& dst, bool reference = false);
+
+  /*
+    kernelName
+    Function naming the kernel picked for this CPU
+      Returns "avx2", "sse4.1", "neon" or "scalar"
+  */
+  static const char* kernelName();
+
+private:
+  // Layout of a source frame: the kernels only run on the pixels whose neighbors all lie within it
+  struct srcLayout {
+    Size srcsize;
+    size_t srcstep;
+    vector< int > offsets; // Byte offset of the top-left neighbor of each scene pixel, within the interior spans
+    vector< Range > spans; // Interior columns of each scene row, the other pixels take the bounds-checked path
+  };
+
+  // Function computing the source offsets and interior spans for the layout of the given frame
+  shared_ptr< const srcLayout > layout(const Mat& src) const;
+
+  Mat _map;  // Integer source coordinates of the top-left neighbor, CV_16SC2
+  Mat _frac; // Interpolation fractions, fy * 32 + fx in 1/32 of pixel, CV_16UC1
+  Size _size;
+  int _nstripes;
+
+  // Layout of the last frame, replaced as a whole so that the calls still using the previous one keep it
+  shared_ptr< const srcLayout > _layout;
+  mutex _layoutLock;
+};
+
+#endif // GRAYWARP_H
@@ -0,0 +1,168 @@
+#include <fstream>
+#include <iomanip>
+
+#include "latency.hpp"
+
+
+
+LatencyHistogram::LatencyHistogram() :
+  _count(0),
+  _max(0)
+{
+  for (int i = 0; i < NBUCKETS; i++)
+    _counts[i] = 0;
+}
+
+
+
+int LatencyHistogram::bucketOf(uint64_t ns)
+{
+  if (ns < (uint64_t) SUB_COUNT)
+    return ns; // Exact values for the smallest durations
+
+  int msb = 63 - __builtin_clzll(ns);
+  int sub = (ns >> (msb - SUB_BITS)) - SUB_COUNT; // Next SUB_BITS bits after the most significant one
+  return SUB_COUNT + (msb - SUB_BITS) * SUB_COUNT + sub;
+}
+
+
+
+int64_t LatencyHistogram::valueOf(int bucket)
+{
+  if (bucket < SUB_COUNT)
+    return bucket;
+
+  int msb = (bucket - SUB_COUNT) / SUB_COUNT + SUB_BITS;
+  int sub = (bucket - SUB_COUNT) % SUB_COUNT;
+  return ((int64_t) (SUB_COUNT + sub + 1) << (msb - SUB_BITS)) - 1;
+}
+
+
+
+void LatencyHistogram::record(int64_t ns)
+{
+  if (ns < 0)
+    ns = 0;
+
+  _counts[bucketOf(ns)].fetch_add(1, memory_order_relaxed);
+  _count.fetch_add(1, memory_order_relaxed);
+
+  int64_t max = _max.load(memory_order_relaxed);
+  while ( (ns > max) && !_max.compare_exchange_weak(max, ns, memory_order_relaxed) )
+    ;
+}
+
+
+
+int64_t LatencyHistogram::percentile(double fraction) const
+{
+  uint64_t count = _count.load(memory_order_relaxed);
+  if (count == 0)
+    return 0;
+
+  uint64_t rank = (uint64_t) (fraction * count + 0.5);
+  if (rank < 1)
+    rank = 1;
+
+  uint64_t seen = 0;
+  for (int i = 0; i < NBUCKETS; i++) {
+    seen += _counts[i].load(memory_order_relaxed);
+    if (seen >= rank)
+      return min(valueOf(i), getMax()); // The bucket bound may exceed the largest duration actually seen
+  }
+  return getMax();
+}
+
+
+
+int64_t LatencyHistogram::getMax() const
+{
+  return _max.load(memory_order_relaxed);
+}
+
+
+
+uint64_t LatencyHistogram::getCount() const
+{
+  return _count.load(memory_order_relaxed);
+}
+
+
+
+void LatencyStats::record(int stage, clock::duration d)
+{
+  _stages[stage].record(chrono::duration_cast< chrono::nanoseconds >(d).count());
+}
+
+
+
+const char* LatencyStats::stageName(int stage)
+{
+  static const char* names[NSTAGES] = { "capture", "warp", "gray", "scan", "pose", "fuse", "publish", "show", "total" };
+  return names[stage];
+}
+
+
+
+void LatencyStats::print(ostream& out) const
+{
+  out << "Latency per stage (ms):" << endl
+      << setw(10) << "stage" << setw(10) << "count" << setw(10) << "p50" << setw(10) << "p90" << setw(10) << "p99" << setw(10) << "max" << endl;
+
+  out << fixed << setprecision(3);
+  for (int s = 0; s < NSTAGES; s++) {
+    const LatencyHistogram& h = _stages[s];
+    if (h.getCount() == 0)
+      continue;
+    out << setw(10) << stageName(s) << setw(10) << h.getCount()
+        << setw(10) << h.percentile(0.50) / 1e6
+        << setw(10) << h.percentile(0.90) / 1e6
+        << setw(10) << h.percentile(0.99) / 1e6
+        << setw(10) << h.getMax() / 1e6 << endl;
+  }
+  out.unsetf(ios::floatfield);
+}
+
+
+
+bool LatencyStats::save(const string& filename) const
+{
+  ofstream file(filename.c_str());
+  if (! file.is_open() )
+    return false;
+
+  print(file);
+  return file.good();
+}
+
+
+
+StageClock::StageClock(LatencyStats& stats) :
+  _stats(stats)
+{
+  start();
+}
+
+
+
+void StageClock::start()
+{
+  _start = _mark = LatencyStats::clock::now();
+}
+
+
+
+void StageClock::lap(int stage)
+{
+  LatencyStats::clock::time_point now = LatencyStats::clock::now();
+  _stats.record(stage, now - _mark);
+  _mark = now;
+}
+
+
+
+void StageClock::end()
+{
+  _mark = LatencyStats::clock::now();
+  _stats.record(STAGE_TOTAL, _mark - _start);
+}
@@ -0,0 +1,128 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <ostream>
+#include <stdint.h>
+
+using namespace std;
+
+
+
+/*
+  Stages of the scan loop whose latency is measured
+*/
+enum latencyStage {
+  STAGE_CAPTURE, // Waiting for the next frame
+  STAGE_WARP,    // Reprojection of the frame, or of the symbols' corners
+  STAGE_GRAY,    // Grayscale conversion
+  STAGE_SCAN,    // ZBar scanning
+  STAGE_POSE,    // Position and angle computation
+  STAGE_FUSE,    // Waiting for every camera and merging their symbols, multi-camera runs only
+  STAGE_PUBLISH, // Console output and network publication
+  STAGE_SHOW,    // Drawing, display and HighGUI events
+  STAGE_TOTAL,   // Whole loop iteration
+  NSTAGES
+};
+
+
+
+/*
+  LatencyHistogram
+  Class counting durations in logarithmic buckets split into 32 linear sub-buckets each,
+  giving about 3% of relative precision from 1 ns up to several minutes in a fixed 16 kB table
+  Recording only performs relaxed atomic increments, so any thread may record without locking
+*/
+class LatencyHistogram
+{
+public:
+  LatencyHistogram();
+
+  // Function adding a duration, in nanoseconds
+  void record(int64_t ns);
+
+  // Function giving the duration, in nanoseconds, below which the given fraction of the recorded ones lie
+  int64_t percentile(double fraction) const;
+
+  int64_t getMax() const;
+  uint64_t getCount() const;
+
+private:
+  static const int SUB_BITS = 5;
+  static const int SUB_COUNT = 1 << SUB_BITS;
+  static const int NBUCKETS = 64 * SUB_COUNT;
+
+  static int bucketOf(uint64_t ns);
+  static int64_t valueOf(int bucket); // Upper bound of a bucket
+
+  atomic< uint64_t > _counts[NBUCKETS];
+  atomic< uint64_t > _count;
+  atomic< int64_t > _max;
+};
+
+
+
+/*
+  LatencyStats
+  Class gathering one histogram per stage of the scan loop
+*/
+class LatencyStats
+{
+public:
+  typedef chrono::steady_clock clock; // Monotonic clock
+
+  // Function adding the duration of a stage
+  void record(int stage, clock::duration d);
+
+  /*
+    print
+    Function writing p50, p90, p99 and maximum latency of each stage, in milliseconds
+      out: input output
+        Stream to write into
+  */
+  void print(ostream& out) const;
+
+  /*
+    save
+    Function writing the same report as print into a file
+      filename: input
+        Full path and name to the file to write
+      Returns if the file could be written
+  */
+  bool save(const string& filename) const;
+
+  static const char* stageName(int stage);
+
+private:
+  LatencyHistogram _stages[NSTAGES];
+};
+
+
+
+/*
+  StageClock
+  Class timing the successive stages of one loop iteration
+  Each lap records the time elapsed since the previous mark
+*/
+class StageClock
+{
+public:
+  StageClock(LatencyStats& stats);
+
+  // Function starting a new iteration
+  void start();
+
+  // Function recording the time elapsed since the previous mark for the given stage
+  void lap(int stage);
+
+  // Function recording the time elapsed since start as the whole iteration
+  void end();
+
+private:
+  LatencyStats& _stats;
+  LatencyStats::clock::time_point _start, _mark;
+};
+
+#endif // LATENCY_H
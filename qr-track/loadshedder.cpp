@@ -0,0 +1,123 @@
+#include <iomanip>
+
+#include "loadshedder.hpp"
+
+// Weight of the latest frame in the smoothed latency
+#define SMOOTHING 0.25f
+// Fractions of the budget above which the loop degrades, and below which it recovers
+#define HIGH_WATER 0.9f
+#define LOW_WATER 0.5f
+
+
+
+LoadShedder::LoadShedder(float budget, int hold, int recover) :
+  _budget(budget),
+  _hold(hold),
+  _recover(recover),
+  _level(SHED_NONE),
+  _smoothed(0),
+  _frames(0),
+  _odd(false),
+  _since(clock::now()),
+  _changes(0),
+  _skipped(0)
+{
+  for (int l = 0; l < NSHEDLEVELS; l++)
+    _times[l] = clock::duration::zero();
+}
+
+
+
+int LoadShedder::update(clock::time_point stamp, clock::time_point now)
+{
+  int level = _level.load(memory_order_relaxed);
+  if (_budget <= 0)
+    return level;
+
+  float latency = chrono::duration< float, milli >(now - stamp).count();
+  _smoothed = (_frames || _changes) ? _smoothed + SMOOTHING * (latency - _smoothed) : latency;
+  _frames++;
+
+  // Going down as soon as the previous change had time to act, going back up only after a longer calm
+  if ( (_smoothed > HIGH_WATER * _budget) && (_frames >= _hold) && (level < NSHEDLEVELS - 1) )
+    change(level + 1, now);
+  else if ( (_smoothed < LOW_WATER * _budget) && (_frames >= _recover) && (level > SHED_NONE) )
+    change(level - 1, now);
+
+  return _level.load(memory_order_relaxed);
+}
+
+
+
+bool LoadShedder::skip()
+{
+  if (_level.load(memory_order_relaxed) < SHED_FRAMES)
+    return false;
+
+  _odd = !_odd;
+  if (_odd)
+    _skipped++;
+  return _odd;
+}
+
+
+
+void LoadShedder::change(int level, clock::time_point now)
+{
+  int previous = _level.load(memory_order_relaxed);
+  _times[previous] += now - _since;
+  _since = now;
+  _frames = 0;
+  _changes++;
+  _level.store(level, memory_order_relaxed);
+}
+
+
+
+int LoadShedder::getLevel() const
+{
+  return _level.load(memory_order_relaxed);
+}
+
+
+
+LoadShedder::clock::duration LoadShedder::getTimeAt(int level) const
+{
+  clock::duration time = _times[level];
+  if (level == _level.load(memory_order_relaxed))
+    time += clock::now() - _since;
+  return time;
+}
+
+
+
+unsigned long LoadShedder::getChanges() const
+{
+  return _changes;
+}
+
+
+
+unsigned long LoadShedder::getSkipped() const
+{
+  return _skipped;
+}
+
+
+
+void LoadShedder::print(ostream& out) const
+{
+  out << "Load shedding for a " << _budget << " ms budget, level changes: " << _changes << " - frames skipped: " << _skipped << endl
+      << fixed << setprecision(3);
+  for (int l = 0; l < NSHEDLEVELS; l++)
+    out << setw(12) << levelName(l) << setw(12) << chrono::duration< double >(getTimeAt(l)).count() << " s" << endl;
+  out.unsetf(ios::floatfield);
+}
+
+
+
+const char* LoadShedder::levelName(int level)
+{
+  static const char* names[NSHEDLEVELS] = { "none", "resolution", "tracked", "highlight", "frames" };
+  return (level >= 0 && level < NSHEDLEVELS) ? names[level] : "?";
+}
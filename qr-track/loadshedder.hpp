@@ -0,0 +1,103 @@
+#ifndef LOADSHEDDER_H
+#define LOADSHEDDER_H
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+
+using namespace std;
+
+
+
+/*
+  Degradation levels of the scan loop, each one also applies the previous ones
+*/
+enum shedLevel {
+  SHED_NONE,       // Every frame fully processed
+  SHED_RESOLUTION, // Image scanned at half the configured resolution
+  SHED_TRACKED,    // Image scanned only around the symbols already found, with periodic sweeps
+  SHED_HIGHLIGHT,  // Found symbols no longer shown
+  SHED_FRAMES,     // One frame out of two skipped
+  NSHEDLEVELS
+};
+
+
+
+/*
+  LoadShedder
+  Class keeping the latency of the scan loop within a budget by degrading its processing progressively
+  The latency of a frame runs from its capture to the end of its processing, and is smoothed over the last frames
+  When it nears the budget, the loop goes one level down; when there is enough headroom again, it goes one level back up
+  Each change is held for a number of frames, so that its effect is measured before the next one
+  The level is read by other threads without locking
+*/
+class LoadShedder
+{
+public:
+  typedef chrono::steady_clock clock;
+
+  /*
+    budget: input
+      Latency budget of a frame in milliseconds, 0 to never degrade
+    hold: input
+      Frames processed at a level before going further down
+    recover: input
+      Frames processed at a level before going back up
+  */
+  LoadShedder(float budget, int hold = 5, int recover = 30);
+
+  /*
+    update
+    Function accounting for a processed frame and setting the level of the next ones
+      stamp: input
+        Capture time of the frame
+      now: input
+        End of its processing
+      Returns the level of the next frame
+  */
+  int update(clock::time_point stamp, clock::time_point now = clock::now());
+
+  /*
+    skip
+    Function telling whether the frame just retrieved should be dropped without processing, to be called once per frame
+      Returns true for one frame out of two at the SHED_FRAMES level
+  */
+  bool skip();
+
+  // Current level, one of shedLevel
+  int getLevel() const;
+
+  // Time spent at a level so far
+  clock::duration getTimeAt(int level) const;
+
+  // Counters: level changes, frames skipped
+  unsigned long getChanges() const;
+  unsigned long getSkipped() const;
+
+  /*
+    print
+    Function writing the time spent at each level and the number of changes
+      out: input output
+        Stream to write into
+  */
+  void print(ostream& out) const;
+
+  static const char* levelName(int level);
+
+private:
+  // Function switching to another level
+  void change(int level, clock::time_point now);
+
+  float _budget;  // In milliseconds
+  int _hold, _recover;
+
+  atomic< int > _level;
+  float _smoothed; // Smoothed latency in milliseconds
+  int _frames;     // Frames processed since the last change
+  bool _odd;       // Alternates at the SHED_FRAMES level
+  clock::time_point _since; // Start of the current level
+  clock::duration _times[NSHEDLEVELS]; // Time spent at each level, the current one excepted
+  unsigned long _changes, _skipped;
+};
+
+#endif // LOADSHEDDER_H
@@ -0,0 +1,135 @@
+#include <algorithm>
+
+#include "motionmodel.hpp"
+
+
+
+/*
+  wrapAngle
+  Function bringing an angle in degrees back within +/-180
+*/
+static float wrapAngle(float angle)
+{
+  while (angle > 180)
+    angle -= 360;
+  while (angle <= -180)
+    angle += 360;
+  return angle;
+}
+
+
+
+MotionModel::MotionModel(float horizon, float accelNoise, float posNoise, float angAccelNoise, float angNoise) :
+  _horizon(horizon),
+  _accelNoise(accelNoise),
+  _posNoise(posNoise),
+  _angAccelNoise(angAccelNoise),
+  _angNoise(angNoise)
+{
+}
+
+
+
+void MotionModel::setHorizon(float horizon)
+{
+  _horizon = horizon;
+}
+
+
+
+void MotionModel::reset(axisFilter& f, float z, float r)
+{
+  f.p = z;
+  f.v = 0;
+  f.P00 = r;
+  f.P01 = 0;
+  f.P11 = 1e6f; // Velocity unknown until the second measurement
+}
+
+
+
+void MotionModel::advance(axisFilter& f, float dt, float q)
+{
+  // x' = F x, P' = F P F' + Q with F = [1 dt; 0 1] and Q the discrete white noise acceleration model
+  f.p += f.v * dt;
+  float dt2 = dt * dt, dt3 = dt2 * dt;
+  f.P00 += 2 * dt * f.P01 + dt2 * f.P11 + q * dt3 / 3;
+  f.P01 += dt * f.P11 + q * dt2 / 2;
+  f.P11 += q * dt;
+}
+
+
+
+void MotionModel::correct(axisFilter& f, float innovation, float r)
+{
+  // Only the value is measured: H = [1 0]
+  float S = f.P00 + r;
+  float K0 = f.P00 / S, K1 = f.P01 / S;
+
+  f.p += K0 * innovation;
+  f.v += K1 * innovation;
+
+  float P00 = f.P00, P01 = f.P01;
+  f.P00 -= K0 * P00;
+  f.P01 -= K0 * P01;
+  f.P11 -= K1 * P01;
+}
+
+
+
+void MotionModel::update(int ID, Point2f center, float angle, clock::time_point stamp)
+{
+  if (ID < 0)
+    return;
+
+  motionTrack& t = _tracks[ID]; // Not valid yet when created
+  float dt = chrono::duration< float >(stamp - t.stamp).count();
+
+  if ( !t.valid || (dt > 4 * _horizon) ) {
+    reset(t.x, center.x, _posNoise);
+    reset(t.y, center.y, _posNoise);
+    reset(t.angle, angle, _angNoise);
+    t.stamp = stamp;
+    t.valid = true;
+    return;
+  }
+
+  if (dt < 0) // Older than the last measurement, e.g. from a slower camera: use it as if it were current
+    dt = 0;
+
+  advance(t.x, dt, _accelNoise);
+  advance(t.y, dt, _accelNoise);
+  advance(t.angle, dt, _angAccelNoise);
+
+  correct(t.x, center.x - t.x.p, _posNoise);
+  correct(t.y, center.y - t.y.p, _posNoise);
+  correct(t.angle, wrapAngle(angle - t.angle.p), _angNoise);
+  t.angle.p = wrapAngle(t.angle.p);
+
+  t.stamp = max(t.stamp, stamp);
+}
+
+
+
+bool MotionModel::predict(int ID, clock::time_point when, Point2f& center, float& angle) const
+{
+  unordered_map< int, motionTrack >::const_iterator found = _tracks.find(ID);
+  if ( (found == _tracks.end()) || !found->second.valid )
+    return false;
+
+  const motionTrack& t = found->second;
+  float dt = chrono::duration< float >(when - t.stamp).count();
+  dt = min(max(dt, 0.f), _horizon);
+
+  center.x = t.x.p + t.x.v * dt;
+  center.y = t.y.p + t.y.v * dt;
+  angle = wrapAngle(t.angle.p + t.angle.v * dt);
+  return true;
+}
+
+
+
+void MotionModel::forget(int ID)
+{
+  _tracks.erase(ID);
+}
@@ -0,0 +1,111 @@
+#ifndef MOTIONMODEL_H
+#define MOTIONMODEL_H
+
+#include <unordered_map>
+#include <chrono>
+
+#include "opencv2/core/core.hpp"
+
+using namespace std;
+using namespace cv;
+
+
+
+/*
+  MotionModel
+  Class estimating the motion of each Metabot with a constant-velocity Kalman filter per coordinate
+  Position and angle are filtered independently, angle innovations wrap around at +/-180 degrees
+  Filters are kept at the capture time of their last measurement, predictions extrapolate them without changing them
+*/
+class MotionModel
+{
+public:
+  typedef chrono::steady_clock clock;
+
+  /*
+    horizon: input
+      Longest extrapolation in seconds, a Metabot not seen for longer stays at its pose extrapolated up to the horizon
+    accelNoise: input
+      Spectral density of the acceleration not explained by the model, in scene units squared per cubic second
+    posNoise: input
+      Variance of a measured position, in scene units squared
+    angAccelNoise: input
+      Spectral density of the angular acceleration, in squared degrees per cubic second
+    angNoise: input
+      Variance of a measured angle, in squared degrees
+  */
+  MotionModel(float horizon = 0.25f, float accelNoise = 1e4f, float posNoise = 4, float angAccelNoise = 1e4f, float angNoise = 4);
+
+  /*
+    update
+    Function correcting the filter of a Metabot with a measured pose
+    A Metabot measured for the first time, or after more than four horizons, restarts with no velocity
+      ID: input
+        ID of the Metabot, the filters are indexed by it
+      center: input
+        Measured position of the center of the Metabot within the scene plane
+      angle: input
+        Measured orientation angle in degrees
+      stamp: input
+        Capture time of the frame the pose was measured in
+  */
+  void update(int ID, Point2f center, float angle, clock::time_point stamp);
+
+  /*
+    predict
+    Function extrapolating the pose of a Metabot at a given time
+      ID: input
+        ID of the Metabot
+      when: input
+        Time at which the pose is wanted, usually now
+      center: output
+        Extrapolated position
+      angle: output
+        Extrapolated angle in degrees, within +/-180
+      Returns false if the Metabot was never measured, outputs are left unchanged then
+  */
+  bool predict(int ID, clock::time_point when, Point2f& center, float& angle) const;
+
+  /*
+    setHorizon
+    Function changing the longest extrapolation
+      horizon: input
+        Longest extrapolation in seconds
+  */
+  void setHorizon(float horizon);
+
+  /*
+    forget
+    Function dropping the filter of a Metabot that left the scene
+      ID: input
+        ID of the Metabot, measuring it again restarts its filter
+  */
+  void forget(int ID);
+
+private:
+  // Constant-velocity Kalman filter of one coordinate
+  struct axisFilter {
+    float p, v;          // Estimated value and rate of change
+    float P00, P01, P11; // Covariance of the estimate, symmetric
+  };
+
+  // Function starting a filter on a first measurement
+  static void reset(axisFilter& f, float z, float r);
+  // Function moving a filter dt seconds forward
+  static void advance(axisFilter& f, float dt, float q);
+  // Function correcting a filter with a measurement whose innovation is given
+  static void correct(axisFilter& f, float innovation, float r);
+
+  struct motionTrack {
+    axisFilter x, y, angle;
+    clock::time_point stamp; // Capture time of the last measurement
+    bool valid = false;
+  };
+
+  unordered_map< int, motionTrack > _tracks; // By ID, which may be sparse
+  float _horizon;
+  float _accelNoise, _posNoise;
+  float _angAccelNoise, _angNoise;
+};
+
+#endif // MOTIONMODEL_H
@@ -0,0 +1,273 @@
+#include <iostream>
+#include <stdlib.h>
+#include "options.hpp"
+
+
+
+/*
+  readInt
+  Function reading the integer value following an option
+    args: input
+      Number of command line arguments
+    argv: input
+      Command line arguments
+    i: input output
+      Index of the option, moved to the index of its value
+    value: output
+      Parsed value
+    minval: input
+      Smallest accepted value
+    Returns if a valid value could be read
+*/
+static bool readInt(int args, char* argv[], int& i, int& value, int minval)
+{
+  if (i + 1 >= args) {
+    cerr << "Missing value for option: " << argv[i] << endl;
+    return false;
+  }
+
+  char* end = NULL;
+  long v = strtol(argv[i + 1], &end, 10);
+  if ( (*end != '\0') || (v < minval) ) {
+    cerr << "Invalid value for option " << argv[i] << ": " << argv[i + 1] << endl;
+    return false;
+  }
+
+  value = (int) v;
+  i++;
+  return true;
+}
+
+
+
+/*
+  readFloat
+  Function reading the decimal value following an option
+    args: input
+      Number of command line arguments
+    argv: input
+      Command line arguments
+    i: input output
+      Index of the option, moved to the index of its value
+    value: output
+      Parsed value
+    minval: input
+      Smallest accepted value
+    Returns if a valid value could be read
+*/
+static bool readFloat(int args, char* argv[], int& i, float& value, float minval)
+{
+  if (i + 1 >= args) {
+    cerr << "Missing value for option: " << argv[i] << endl;
+    return false;
+  }
+
+  char* end = NULL;
+  float v = strtof(argv[i + 1], &end);
+  if ( (end == argv[i + 1]) || (*end != '\0') || !(v >= minval) ) {
+    cerr << "Invalid value for option " << argv[i] << ": " << argv[i + 1] << endl;
+    return false;
+  }
+
+  value = v;
+  i++;
+  return true;
+}
+
+
+
+/*
+  readString
+  Function reading the text value following an option
+    args: input
+      Number of command line arguments
+    argv: input
+      Command line arguments
+    i: input output
+      Index of the option, moved to the index of its value
+    value: output
+      Read value
+    Returns if a value could be read
+*/
+static bool readString(int args, char* argv[], int& i, string& value)
+{
+  if (i + 1 >= args) {
+    cerr << "Missing value for option: " << argv[i] << endl;
+    return false;
+  }
+
+  value = argv[++i];
+  return true;
+}
+
+
+
+bool readOptions(int args, char* argv[], int first, trackOptions& opts, bool publishing)
+{
+  for (int i = first; i < args; i++) {
+    string opt(argv[i]);
+
+    // Only qr-scan publishes the poses, the other tools would silently ignore these
+    if ( !publishing && ( (opt == "--deadband") || (opt == "--angle-deadband") || (opt == "--publish-rate") ||
+                          (opt == "--extrapolate") || (opt == "--horizon") || (opt == "--evict") ) ) {
+      cerr << "Option only accepted by qr-scan: " << opt << endl;
+      return false;
+    }
+
+    if (opt == "--corners")
+      opts.corners = true;
+    else if (opt == "--remap")
+      opts.remap = true;
+    else if (opt == "--luma")
+      opts.luma = true;
+    else if (opt == "--fused")
+      opts.fused = true;
+    else if (opt == "--stripes") {
+      if (! readInt(args, argv, i, opts.stripes, 0) )
+        return false;
+    }
+    else if (opt == "--warp-bench") {
+      if (! readInt(args, argv, i, opts.warpbench, 1) )
+        return false;
+    }
+    else if (opt == "--roi")
+      opts.roi = true;
+    else if (opt == "--roi-margin") {
+      if (! readInt(args, argv, i, opts.roimargin, 0) )
+        return false;
+    }
+    else if (opt == "--sweep") {
+      if (! readInt(args, argv, i, opts.sweep, 1) )
+        return false;
+    }
+    else if (opt == "--tiles")
+      opts.tiles = true;
+    else if (opt == "--footprint") {
+      if (! readInt(args, argv, i, opts.footprint, 1) )
+        return false;
+    }
+    else if (opt == "--pyramid") {
+      if (! readInt(args, argv, i, opts.pyramid, 0) )
+        return false;
+    }
+    else if (opt == "--threads") {
+      if (! readInt(args, argv, i, opts.threads, 0) )
+        return false;
+    }
+    else if (opt == "--latency-file") {
+      if (! readString(args, argv, i, opts.latencyfile) )
+        return false;
+    }
+    else if (opt == "--log") {
+      if (! readString(args, argv, i, opts.logfile) )
+        return false;
+    }
+    else if (opt == "--trajectory") {
+      if (! readString(args, argv, i, opts.trajectoryfile) )
+        return false;
+    }
+    else if (opt == "--record") {
+      if (! readString(args, argv, i, opts.recordfile) )
+        return false;
+    }
+    else if (opt == "--realtime")
+      opts.realtime = true;
+    else if (opt == "--budget") {
+      if (! readFloat(args, argv, i, opts.budget, 0) )
+        return false;
+    }
+    else if (opt == "--drift") {
+      if (! readFloat(args, argv, i, opts.drift, 0) )
+        return false;
+    }
+    else if (opt == "--drift-period") {
+      if (! readFloat(args, argv, i, opts.driftperiod, 0.1) )
+        return false;
+    }
+    else if (opt == "--headless")
+      opts.headless = true;
+    else if (opt == "--preview-rate") {
+      if (! readFloat(args, argv, i, opts.previewrate, 0.1) )
+        return false;
+    }
+    else if (opt == "--camera") {
+      string calib, source;
+      if ( !readString(args, argv, i, calib) || !readString(args, argv, i, source) )
+        return false;
+      opts.cameras.push_back(make_pair(calib, source));
+    }
+    else if (opt == "--deadband") {
+      if (! readFloat(args, argv, i, opts.deadband, 0) )
+        return false;
+    }
+    else if (opt == "--angle-deadband") {
+      if (! readFloat(args, argv, i, opts.angledeadband, 0) )
+        return false;
+    }
+    else if (opt == "--publish-rate") {
+      if (! readFloat(args, argv, i, opts.publishrate, 0) )
+        return false;
+    }
+    else if (opt == "--extrapolate") {
+      if (! readFloat(args, argv, i, opts.extrapolate, 0) )
+        return false;
+    }
+    else if (opt == "--horizon") {
+      if (! readInt(args, argv, i, opts.horizon, 0) )
+        return false;
+    }
+    else if (opt == "--evict") {
+      if (! readInt(args, argv, i, opts.evict, 0) )
+        return false;
+    }
+    else {
+      cerr << "Unknown option: " << opt << endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+
+string optionsUsage(bool publishing)
+{
+  string usage =
+    "Options:\n"
+    "  --corners        Scan the camera frame as is and reproject only the symbols' corners\n"
+    "  --remap          Reproject a grayscale frame through precomputed fixed-point tables\n"
+    "  --fused          Reproject and convert to grayscale in a single vectorized pass, without a color scene\n"
+    "  --luma           Read only the luma plane of the frames from the video source, Y4M files always are\n"
+    "  --stripes <n>    Number of row stripes remapped in parallel, default: one per CPU\n"
+    "  --warp-bench <n> Time <n> reprojections of the first frame with and without the tables\n"
+    "  --roi            Scan only around the symbols already found on most frames\n"
+    "  --roi-margin <n> Distance in pixels a symbol may move between two frames, default: 40\n"
+    "  --sweep <n>      Sweep the whole image every <n> frames, or as soon as a symbol is lost, default: 10\n"
+    "  --tiles          Scan overlapping tiles of the image in parallel\n"
+    "  --footprint <n>  Largest side in pixels of a symbol in the scanned image, default: 150\n"
+    "  --pyramid <n>    Scan the image halved <n> times, then refine the symbols at full resolution, default: 0\n"
+    "  --threads <n>    Number of scanning threads, default: one per CPU\n"
+    "  --latency-file <file>  Save the per-stage latency report into <file> when the loop ends\n"
+    "  --log <file>     Log the symbols' data into a binary <file>, decoded by qr-log, instead of the console\n"
+    "  --trajectory <file>   Append the poses to an indexed trajectory <file>, queried by qr-traj\n"
+    "  --record <file>  Save the raw frames read from the video source into <file>, to be replayed as a .qrf video source\n"
+    "  --realtime       Replay .qrf video sources at the pace they were captured instead of as fast as possible\n"
+    "  --budget <ms>    Degrade the processing step by step when a frame takes longer than <ms> from capture to results, default: never\n"
+    "  --drift <d>      Correct the calibration when the anchor tags of the scene drift more than <d> scene units, default: never\n"
+    "  --drift-period <s>    Check the anchor tags every <s> seconds, default: 5\n"
+    "  --headless       Open no window, for computers without a display\n"
+    "  --preview-rate <r>    Show the found symbols at most <r> times per second, at least 0.1, default: 10\n"
+    "  --camera <calib-data.yml> <video-source>  Track with one more camera calibrated on the same scene, may be repeated\n";
+  if (!publishing)
+    return usage;
+
+  return usage +
+    "Publication options:\n"
+    "  --deadband <d>   Publish a Metabot's position only once it moved more than <d> scene units, default: 0\n"
+    "  --angle-deadband <a>  Publish a Metabot's angle only once it turned more than <a> degrees, default: 0\n"
+    "  --publish-rate <r>    Publish at most <r> pose batches per second, default: one per frame\n"
+    "  --extrapolate <r>     Publish <r> times per second the poses extrapolated to the current time by a motion model\n"
+    "  --horizon <ms>   Longest extrapolation of a pose in milliseconds, default: 250\n"
+    "  --evict <ms>     Forget a Metabot not seen for <ms> milliseconds, default: never\n";
+}
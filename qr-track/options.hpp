@@ -0,0 +1,80 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <string>
+#include <vector>
+#include <utility>
+
+using namespace std;
+
+
+
+/*
+  trackOptions
+  Structure gathering the optional parameters of a tracking run
+  Every field keeps the behavior of the original tracker by default
+*/
+struct trackOptions {
+  bool corners = false; // Scan the raw camera frame and reproject only the symbols' corners instead of warping the whole frame
+  bool remap = false;   // Reproject through precomputed fixed-point tables, converting to grayscale first
+  bool luma = false;    // Ask the video sources for the luma plane only, instead of BGR frames
+  bool fused = false;   // Reproject BGR frames straight to grayscale in a single vectorized pass
+  int stripes = 0;      // Number of row stripes remapped in parallel, 0 for one per CPU
+  int warpbench = 0;    // Number of iterations of the reprojection benchmark run on the first frame, 0 to skip it
+  bool roi = false;     // Scan only around the symbols already found, sweeping the whole image periodically
+  int roimargin = 40;   // Distance in pixels a symbol may move between two frames
+  int sweep = 10;       // Period in frames of the full image sweeps
+  bool tiles = false;   // Scan overlapping tiles of the image on a pool of threads
+  int footprint = 150;  // Largest side in pixels of a symbol in the scanned image, quiet zone included
+  int pyramid = 0;      // Number of times the image is halved before scanning, 0 to scan at full resolution
+  int threads = 0;      // Number of scanning threads, 0 for one per CPU
+  string latencyfile;   // File into which the latency report is saved when the loop ends, none if empty
+  string logfile;       // Binary file into which the symbols' data is logged, the console gets it as text if empty
+  string trajectoryfile; // Indexed trajectory file into which the poses are appended, none if empty
+  string recordfile;    // Frame file into which the raw frames of the video source are saved, none if empty
+  bool realtime = false;   // Replay frame files at their capture pace, as a live camera
+  float budget = 0;        // Latency budget of a frame in milliseconds, from capture to the end of its processing, 0 to never shed load
+  float drift = 0;         // Distance in scene units the anchor tags may drift before the transformation is corrected, 0 to never check
+  float driftperiod = 5;   // Period in seconds of the drift checks
+  bool headless = false;   // Open no window at all
+  float previewrate = 10;  // Largest number of images per second shown by the visualization thread
+  float deadband = 0;      // Distance in scene units a Metabot must move before its position is published again
+  float angledeadband = 0; // Rotation in degrees a Metabot must turn before its angle is published again
+  float publishrate = 0;   // Largest number of pose batches published per second, 0 for one per frame
+  float extrapolate = 0;   // Rate at which poses extrapolated to the current time are published, 0 to publish the measured ones
+  int horizon = 250;       // Longest extrapolation in milliseconds
+  int evict = 0;           // Time in milliseconds after which a Metabot not seen leaves the scene, 0 to keep them all
+  vector< pair< string, string > > cameras; // Additional (calibration file, video source) pairs looking at the same scene
+};
+
+
+
+/*
+  readOptions
+  Function parsing the optional command line parameters following the mandatory ones
+    args: input
+      Number of command line arguments, as given to main
+    argv: input
+      Command line arguments, as given to main
+    first: input
+      Index of the first optional argument
+    opts: output
+      Parsed options, fields not given on the command line keep their default value
+    publishing: input
+      Whether the options of the pose publication, only used by qr-scan, are accepted
+    Returns if every optional argument could be parsed
+*/
+bool readOptions(int args, char* argv[], int first, trackOptions& opts, bool publishing = false);
+
+
+
+/*
+  optionsUsage
+  Function describing the optional parameters accepted by readOptions
+    publishing: input
+      Whether to describe the options of the pose publication too
+    Returns a multi-line text ready to be written in the console
+*/
+string optionsUsage(bool publishing = false);
+
+#endif // OPTIONS_H
@@ -0,0 +1,180 @@
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include "pipeline.hpp"
+
+
+
+Pipeline::Pipeline(const Mat& M, Size scnsize, const trackOptions& opts, const Ptr< WarpMap >& warpmap, const Ptr< GrayWarp >& graywarp) :
+  _M(M),
+  _scnsize(scnsize),
+  _opts(opts),
+  _sceneOK(false),
+  _level(SHED_NONE),
+  _scanned(0),
+  _tracker(opts.roimargin, opts.sweep)
+{
+  _scanner.set_config(ZBAR_QRCODE, ZBAR_CFG_ENABLE, 1);
+
+  if (opts.tiles)
+    _tiler = new TileScanner(opts.footprint, opts.threads);
+  if (opts.pyramid)
+    _pyramid = new PyramidScanner(opts.pyramid, opts.roimargin);
+  if (opts.budget > 0)
+    _coarser = new PyramidScanner(opts.pyramid + 1, opts.roimargin);
+
+  if ( warpmap.empty() && graywarp.empty() )
+    prepareTables(M, scnsize, opts, _warpmap, _graywarp);
+  else {
+    _warpmap = warpmap;
+    _graywarp = graywarp;
+  }
+}
+
+
+
+int Pipeline::process(const Mat& frame, vector< qrSymbol >& symbols, StageClock& clk)
+{
+  reproject(frame, clk);
+  return scan(symbols, clk);
+}
+
+
+
+void Pipeline::reproject(const Mat& frame, StageClock& clk)
+{
+  _frame = frame;
+  bool luma = (frame.channels() == 1); // The source delivered the luma plane only
+
+  if (luma) {
+    if (_opts.corners)
+      _gray = frame; // Scanned as is, only the symbols' corners will be reprojected
+    else if (_opts.remap)
+      _warpmap->apply(frame, _gray);
+    else
+      warpPerspective(frame, _gray, _M, _scnsize); // A single channel to reproject
+    clk.lap(STAGE_WARP);
+  }
+  else if (_opts.corners) {
+    cvtColor(frame, _gray, CV_BGR2GRAY); // Scan the camera frame as is, only the symbols' corners will be reprojected
+    clk.lap(STAGE_GRAY);
+  }
+  else if (_opts.remap) {
+    cvtColor(frame, _framegray, CV_BGR2GRAY); // Convert first, a single channel is then reprojected
+    clk.lap(STAGE_GRAY);
+    _warpmap->apply(_framegray, _gray); // Apply the precomputed tables
+    clk.lap(STAGE_WARP);
+  }
+  else if (_opts.fused) {
+    _graywarp->apply(frame, _gray); // Reproject and convert in a single pass, without a color scene
+    clk.lap(STAGE_WARP);
+  }
+  else {
+    warpPerspective(frame, _scene, _M, _scnsize); // Apply this transformation on the whole image, the captured frame is left untouched
+    clk.lap(STAGE_WARP);
+    cvtColor(_scene, _gray, CV_BGR2GRAY); // Get grayscale image for scanning phase
+    clk.lap(STAGE_GRAY);
+  }
+  _sceneOK = !(_opts.remap || _opts.fused || luma); // Scenes reprojected to grayscale are only converted back to color if they are viewed
+}
+
+
+
+int Pipeline::scan(vector< qrSymbol >& symbols, StageClock& clk)
+{
+  // Scan for codes in the image, only within the tracked windows on most frames, or tile by tile in parallel when enabled
+  // When shedding load, the image is scanned at a coarser level, then only within the tracked windows,
+  // swept at the coarser level too so that no shed frame costs more than at the level below
+  // With --roi, the windows are already tracked: they are scanned at the coarser level first, then the sweeps too
+  PyramidScanner* coarser = _coarser;
+  int nsyms;
+  if (_opts.roi || (_level >= SHED_TRACKED)) {
+    nsyms = _tracker.scan(_scanner, _gray, symbols, (_level >= SHED_TRACKED) ? coarser : NULL, (_level >= SHED_RESOLUTION) ? coarser : NULL);
+    _scanned = _tracker.getScanned();
+  }
+  else if (_level >= SHED_RESOLUTION) {
+    nsyms = _coarser->scan(_scanner, _gray, symbols);
+    _scanned = _coarser->getScanned();
+  }
+  else if (_opts.tiles) {
+    nsyms = _tiler->scan(_gray, symbols);
+    _scanned = _tiler->getScanned();
+  }
+  else if (_opts.pyramid) {
+    nsyms = _pyramid->scan(_scanner, _gray, symbols);
+    _scanned = _pyramid->getScanned();
+  }
+  else {
+    nsyms = scanSymbols(_scanner, _gray, symbols);
+    _scanned = _gray.total();
+  }
+  clk.lap(STAGE_SCAN);
+
+  // Extract results
+  if (_opts.corners) {
+    projectSymbols(symbols, _M); // Map the location points into the scene plane
+    clk.lap(STAGE_WARP);
+  }
+
+  for(size_t s = 0; s < symbols.size(); s++)
+    computePose(symbols[s]);
+  clk.lap(STAGE_POSE);
+
+  return nsyms;
+}
+
+
+
+void Pipeline::shed(int level)
+{
+  _level = _coarser ? level : SHED_NONE;
+}
+
+
+
+void Pipeline::retarget(const Mat& M, const Ptr< WarpMap >& warpmap, const Ptr< GrayWarp >& graywarp)
+{
+  _M = M;
+  _warpmap = warpmap;
+  _graywarp = graywarp;
+}
+
+
+
+void Pipeline::prepareTables(const Mat& M, Size scnsize, const trackOptions& opts, Ptr< WarpMap >& warpmap, Ptr< GrayWarp >& graywarp)
+{
+  warpmap.release();
+  graywarp.release();
+
+  if (opts.remap)
+    warpmap = new WarpMap(M, scnsize, opts.stripes);
+  else if (opts.fused)
+    graywarp = new GrayWarp(M, scnsize, opts.stripes);
+}
+
+
+
+Mat& Pipeline::view()
+{
+  if (_opts.corners && (_frame.channels() != 1))
+    return _frame;
+
+  if (! _sceneOK) {
+    cvtColor(_gray, _scene, CV_GRAY2BGR); // Color copy of the scene, or of the luma frame, to draw on
+    _sceneOK = true;
+  }
+  return _scene;
+}
+
+
+
+const Mat& Pipeline::getGray() const
+{
+  return _gray;
+}
+
+
+
+long Pipeline::getScanned() const
+{
+  return _scanned;
+}
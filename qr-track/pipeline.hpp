@@ -0,0 +1,157 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <vector>
+
+#include "opencv2/core/core.hpp"
+
+#include <zbar.h>
+
+#include "options.hpp"
+#include "symbols.hpp"
+#include "warpmap.hpp"
+#include "graywarp.hpp"
+#include "roitracker.hpp"
+#include "tilescanner.hpp"
+#include "pyramidscanner.hpp"
+#include "latency.hpp"
+#include "loadshedder.hpp"
+
+using namespace std;
+using namespace cv;
+using namespace zbar;
+
+
+
+/*
+  Pipeline
+  Class processing camera frames into symbol poses on the CPU: reprojection, grayscale conversion, scanning and pose computation
+  Frames may be BGR or already reduced to their luma plane by the source
+  The same instance is meant to process every frame of a stream, so that tables, scanners and tracked windows are kept
+  Shared by the tracker and the offline benchmark, so that both measure the exact same path
+*/
+class Pipeline
+{
+public:
+  /*
+    M: input
+      Transformation matrix to reproject the images from the video stream
+    scnsize: input
+      Dimensions of the scene, bounding the reprojected images
+    opts: input
+      Options of the run, selecting the reprojection and scanning methods
+    warpmap, graywarp: input
+      Reprojection tables computed for M by prepareTables, shared with other pipelines of the same camera,
+      both empty to compute them
+  */
+  Pipeline(const Mat& M, Size scnsize, const trackOptions& opts, const Ptr< WarpMap >& warpmap = Ptr< WarpMap >(), const Ptr< GrayWarp >& graywarp = Ptr< GrayWarp >());
+
+  /*
+    process
+    Function finding the symbols of a frame and computing their pose in the scene plane
+      frame: input
+        BGR camera frame, kept as the view when the symbols are located in the camera frame
+        or luma plane of the camera frame, which skips the grayscale conversion
+      symbols: output
+        Symbols found, with their pose computed
+      clk: input output
+        Clock of the current iteration, a lap is recorded for each stage
+      Returns the number of symbols found
+  */
+  int process(const Mat& frame, vector< qrSymbol >& symbols, StageClock& clk);
+
+  /*
+    reproject
+    Function performing the first half of process: reprojection and grayscale conversion of a frame
+      frame: input
+        BGR camera frame or its luma plane, as for process
+      clk: input output
+        Clock of the current iteration, a lap is recorded for each stage
+  */
+  void reproject(const Mat& frame, StageClock& clk);
+
+  /*
+    scan
+    Function performing the second half of process: scanning the image prepared by reproject and computing the poses
+    May run on another thread than reproject, as long as the two calls do not overlap
+      symbols: output
+        Symbols found, with their pose computed
+      clk: input output
+        Clock of the current iteration, a lap is recorded for each stage
+      Returns the number of symbols found
+  */
+  int scan(vector< qrSymbol >& symbols, StageClock& clk);
+
+  /*
+    shed
+    Function degrading the scanning of the next frames to keep up with the camera
+      level: input
+        One of shedLevel: from SHED_RESOLUTION, the image is scanned at half the configured resolution,
+        the tracked windows only with --roi, from SHED_TRACKED, only around the symbols already found,
+        with the periodic sweeps at half resolution too, the other levels are up to the loop
+  */
+  void shed(int level);
+
+  /*
+    retarget
+    Function switching to another transformation matrix between two frames
+      M: input
+        New transformation matrix from the camera frame to the scene plane
+      warpmap: input
+        Reprojection tables computed for M by prepareTables, so that the switch itself costs nothing
+      graywarp: input
+        Single-pass reprojection computed for M by prepareTables
+  */
+  void retarget(const Mat& M, const Ptr< WarpMap >& warpmap, const Ptr< GrayWarp >& graywarp);
+
+  /*
+    prepareTables
+    Function computing the reprojection tables that a pipeline run with the given options needs for a transformation matrix
+    Lengthy, but it may run on any thread
+      M: input
+        Transformation matrix from the camera frame to the scene plane
+      scnsize: input
+        Dimensions of the scene, bounding the reprojected images
+      opts: input
+        Options of the run, selecting the reprojection method
+      warpmap: output
+        Fixed-point tables with opts.remap, empty otherwise
+      graywarp: output
+        Single-pass reprojection with opts.fused, empty otherwise
+  */
+  static void prepareTables(const Mat& M, Size scnsize, const trackOptions& opts, Ptr< WarpMap >& warpmap, Ptr< GrayWarp >& graywarp);
+
+  /*
+    view
+    Function giving the color image in which the symbols of the last frame are located
+    Drawing on it is allowed: it is either the reprojected scene or the last processed frame
+      Returns the camera frame in corner mode, the reprojected scene otherwise
+  */
+  Mat& view();
+
+  // Image given to the scanner for the last frame
+  const Mat& getGray() const;
+
+  // Number of pixels handed to ZBar for the last frame
+  long getScanned() const;
+
+private:
+  Mat _M;
+  Size _scnsize;
+  trackOptions _opts;
+
+  Mat _frame, _framegray, _scene, _gray; // Images that will be read, reprojected and scanned
+  bool _sceneOK; // The color scene matches the last frame
+  int _level;    // Degradation level, one of shedLevel
+  long _scanned; // Pixels handed to ZBar for the last frame
+
+  ImageScanner _scanner;   // Code scanner
+  RoiTracker _tracker;     // Search windows around the symbols already found
+  Ptr< TileScanner > _tiler; // Pool of scanners working on overlapping tiles
+  Ptr< PyramidScanner > _pyramid; // Coarse level scanning with full resolution refinement
+  Ptr< PyramidScanner > _coarser; // Scanning one level coarser than configured, when shedding load
+  Ptr< WarpMap > _warpmap;   // Reprojection tables, computed once for M and replaced only along with it, possibly shared
+  Ptr< GrayWarp > _graywarp; // Single-pass reprojection to grayscale
+};
+
+#endif // PIPELINE_H
@@ -0,0 +1,259 @@
+#include <iostream>
+#include <string.h>
+
+#include "poselog.hpp"
+
+
+
+PoseLog::PoseLog(const string& path, const string& trajectory, size_t capacity) :
+  _path(path),
+  _file(NULL),
+  _trajectoryPath(trajectory),
+  _head(0),
+  _tail(0),
+  _started(false),
+  _pending(0),
+  _running(false),
+  _written(0),
+  _dropped(0)
+{
+  size_t size = 2;
+  while (size < capacity)
+    size *= 2;
+  _ring.resize(size);
+  _mask = size - 1;
+
+  memset(&_current, 0, sizeof(_current));
+}
+
+
+
+PoseLog::~PoseLog()
+{
+  stop();
+}
+
+
+
+bool PoseLog::start()
+{
+  if (_running)
+    return false;
+  _failed.clear();
+
+  _start = clock::now();
+  int64_t opened = chrono::duration_cast< chrono::microseconds >(chrono::system_clock::now().time_since_epoch()).count();
+
+  if (! _trajectoryPath.empty() ) {
+    _trajectory.reset(new TrajectoryWriter);
+    if (! _trajectory->open(_trajectoryPath, opened) ) {
+      _trajectory.reset();
+      _failed.push_back(_trajectoryPath);
+    }
+  }
+
+  if (! _path.empty() ) {
+    _file = fopen(_path.c_str(), "wb");
+    if (_file) {
+      // Header: magic string, record size, opening time as system time in microseconds
+      uint32_t size = sizeof(logRecord);
+      fwrite(POSELOG_MAGIC, 1, 8, _file);
+      fwrite(&size, sizeof(size), 1, _file);
+      fwrite(&opened, sizeof(opened), 1, _file);
+    }
+    else
+      _failed.push_back(_path); // Written in the console instead
+  }
+
+  _running = true;
+  _writeThread = thread(&PoseLog::write, this);
+  return _failed.empty();
+}
+
+
+
+void PoseLog::stop()
+{
+  if (_running && _pending) {
+    // The loop is over, waiting for the writer thread to make room for the last drops is fine now
+    while (_head.load(memory_order_relaxed) - _tail.load(memory_order_acquire) >= _ring.size())
+      this_thread::sleep_for(chrono::milliseconds(1));
+    _head.store(pushDropped(_head.load(memory_order_relaxed)), memory_order_release);
+  }
+
+  _running = false;
+  if (_writeThread.joinable())
+    _writeThread.join();
+
+  if (_file) {
+    fclose(_file);
+    _file = NULL;
+  }
+  if (_trajectory) {
+    _trajectory->close();
+    _trajectory.reset();
+  }
+}
+
+
+
+void PoseLog::beginFrame(clock::time_point stamp, int nsyms)
+{
+  if (_started)
+    _current.frame++;
+  _started = true;
+
+  _current.stamp = chrono::duration_cast< chrono::microseconds >(stamp - _start).count();
+  _current.count = nsyms;
+
+  if (nsyms <= 0) {
+    logRecord r = _current;
+    r.count = 0;
+    r.ID = LOG_EMPTY;
+    r.x = r.y = r.angle = 0;
+    push(r);
+  }
+}
+
+
+
+void PoseLog::record(int ID, Point2f center, float angle)
+{
+  logRecord r = _current;
+  r.ID = ID;
+  r.x = center.x;
+  r.y = center.y;
+  r.angle = angle;
+  push(r);
+}
+
+
+
+unsigned long PoseLog::getWritten() const
+{
+  return _written;
+}
+
+
+
+unsigned long PoseLog::getDropped() const
+{
+  return _dropped;
+}
+
+
+
+const vector< string >& PoseLog::getFailed() const
+{
+  return _failed;
+}
+
+
+
+void PoseLog::push(const logRecord& r)
+{
+  size_t head = _head.load(memory_order_relaxed);
+  size_t free = _ring.size() - (head - _tail.load(memory_order_acquire));
+
+  // Records dropped earlier take a slot of their own, right before the next record kept
+  if (free < (_pending ? 2u : 1u)) {
+    _pending++;
+    _dropped.fetch_add(1, memory_order_relaxed);
+    return;
+  }
+
+  if (_pending)
+    head = pushDropped(head);
+
+  _ring[head & _mask] = r;
+  _head.store(head + 1, memory_order_release);
+}
+
+
+
+size_t PoseLog::pushDropped(size_t head)
+{
+  logRecord& d = _ring[head & _mask];
+  d = _current;
+  d.count = _pending;
+  d.ID = LOG_DROPPED;
+  d.x = d.y = d.angle = 0;
+  _pending = 0;
+  return head + 1;
+}
+
+
+
+void PoseLog::write()
+{
+  size_t tail = _tail.load(memory_order_relaxed);
+  uint32_t frame = 0;
+  bool first = true;
+
+  while (true) {
+    bool running = _running; // Read before the ring, so that the records pushed before stop() are all written
+    size_t head = _head.load(memory_order_acquire);
+
+    if (head == tail) {
+      if (_file)
+        fflush(_file);
+      else
+        cout.flush();
+      if (!running)
+        break;
+      this_thread::sleep_for(chrono::milliseconds(5));
+      continue;
+    }
+
+    unsigned long n = head - tail;
+    for (; tail != head; tail++) {
+      const logRecord& r = _ring[tail & _mask];
+      bool starts = first || (r.frame != frame); // First record of its frame
+      if (r.ID != LOG_DROPPED) {
+        frame = r.frame;
+        first = false;
+      }
+
+      if (_file)
+        fwrite(&r, sizeof(r), 1, _file);
+      else
+        printRecord(cout, r, starts);
+
+      if ( _trajectory && (r.ID != LOG_DROPPED) ) {
+        if (starts)
+          _trajectory->beginFrame(r.stamp);
+        if (r.ID != LOG_EMPTY)
+          _trajectory->add(r.ID, r.x, r.y, r.angle);
+      }
+    }
+    _written.fetch_add(n, memory_order_relaxed);
+    _tail.store(tail, memory_order_release); // The slots are given back once written
+  }
+}
+
+
+
+void printRecord(ostream& out, const logRecord& r, bool first)
+{
+  if (r.ID == LOG_DROPPED) {
+    out << r.count << " record(s) dropped" << '\n';
+    return;
+  }
+
+  if (first || (r.ID == LOG_EMPTY))
+    out << r.count << " symbol(s) found in frame " << r.frame << " at " << r.stamp / 1000. << " ms" << '\n';
+  if (r.ID != LOG_EMPTY)
+    out << "Data: \"" << r.ID << "\" - Angle: " << r.angle << " - Center: " << Point2f(r.x, r.y) << '\n';
+}
+
+
+
+bool readLog(istream& in, int64_t& start)
+{
+  char magic[8];
+  uint32_t size = 0;
+  if (! (in.read(magic, 8) && in.read((char*) &size, sizeof(size)) && in.read((char*) &start, sizeof(start))) )
+    return false;
+
+  return (memcmp(magic, POSELOG_MAGIC, 8) == 0) && (size == sizeof(logRecord));
+}
@@ -0,0 +1,178 @@
+#ifndef POSELOG_H
+#define POSELOG_H
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <istream>
+#include <ostream>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "opencv2/core/core.hpp"
+
+#include "trajectory.hpp"
+
+using namespace std;
+using namespace cv;
+
+
+
+/*
+  logRecord
+  Structure of a log record, 32 bytes with no padding, written as is in the host byte order
+  A frame with symbols gives one record per symbol, a frame without any gives a single record with ID -1
+  Records lost because the ring was full are accounted for by a record with ID -2 before the next one kept
+*/
+struct logRecord {
+  int64_t stamp;   // Capture time of the frame, in microseconds since the log was opened
+  uint32_t frame;  // Index of the frame, from 0
+  uint32_t count;  // Number of symbols found in the frame, or of records dropped for an ID of -2
+  int32_t ID;      // ID of the Metabot, -1 for a frame without any, -2 for dropped records
+  float x;         // Position of the center of the Metabot within the scene plane
+  float y;
+  float angle;     // Orientation angle of the Metabot within the scene plane, in degrees
+};
+
+// Log files start with this magic string, followed by the record size and the opening time
+#define POSELOG_MAGIC "QRPOSLOG"
+
+enum logIDs {
+  LOG_EMPTY = -1,  // Frame without any symbol
+  LOG_DROPPED = -2 // Records dropped
+};
+
+
+
+/*
+  PoseLog
+  Class logging the symbols found by the scan loop without ever blocking it
+  The loop fills a single-producer single-consumer ring of records, emptied by a writer thread
+  When the ring is full, records are dropped and counted instead of making the loop wait
+  The writer thread saves the records in a binary file, or writes them as text in the console if no file is given
+  It may also append the poses to a trajectory file, at no extra cost for the loop
+*/
+class PoseLog
+{
+public:
+  typedef chrono::steady_clock clock;
+
+  /*
+    path: input
+      Binary file to write, created or truncated, the console gets text if empty
+    trajectory: input
+      Trajectory file to write, created or truncated, none if empty
+    capacity: input
+      Number of records the ring holds, rounded up to a power of two
+  */
+  PoseLog(const string& path, const string& trajectory = "", size_t capacity = 16384);
+  ~PoseLog();
+
+  /*
+    start
+    Function opening the files and launching the writer thread
+    A file that cannot be created is left out: the records go to the console instead of the binary log,
+    and no trajectory is written, but the thread is launched anyway so that nothing is lost
+    Returns if every file could be created, getFailed then gives the others
+  */
+  bool start();
+
+  /*
+    stop
+    Function writing the records left, closing the files and waiting for the writer thread to end
+  */
+  void stop();
+
+  /*
+    beginFrame
+    Function starting the records of a new frame, only the scan loop may call it
+      stamp: input
+        Capture time of the frame
+      nsyms: input
+        Number of symbols found in the frame, a frame without any is logged as such
+  */
+  void beginFrame(clock::time_point stamp, int nsyms);
+
+  /*
+    record
+    Function logging a symbol of the current frame, only the scan loop may call it
+      ID: input
+        ID of the Metabot
+      center: input
+        Position of the center of the Metabot within the scene plane
+      angle: input
+        Orientation angle of the Metabot within the scene plane
+  */
+  void record(int ID, Point2f center, float angle);
+
+  // Number of records written and dropped so far
+  unsigned long getWritten() const;
+  unsigned long getDropped() const;
+
+  // Files that start could not create
+  const vector< string >& getFailed() const;
+
+private:
+  // Function adding a record to the ring, or counting it as dropped if the ring is full
+  void push(const logRecord& r);
+
+  // Function writing the record accounting for the pending drops at the given ring position, returns the next position
+  size_t pushDropped(size_t head);
+
+  // Writer thread main loop
+  void write();
+
+  string _path;
+  FILE* _file; // Binary log, null for text in the console
+  string _trajectoryPath;
+  unique_ptr< TrajectoryWriter > _trajectory; // Null if no trajectory is written
+  vector< string > _failed;
+
+  vector< logRecord > _ring;
+  size_t _mask;
+  atomic< size_t > _head; // Next record written by the scan loop
+  atomic< size_t > _tail; // Next record read by the writer thread
+
+  // State of the scan loop side
+  logRecord _current;     // Frame fields of the current frame
+  clock::time_point _start;
+  bool _started;
+  unsigned long _pending; // Dropped records not accounted for in the ring yet
+
+  thread _writeThread;
+  atomic< bool > _running;
+  atomic< unsigned long > _written;
+  atomic< unsigned long > _dropped;
+};
+
+
+
+/*
+  printRecord
+  Function writing a record as text, in the same form as the console output of the scan loop
+    out: input output
+      Stream to write into
+    r: input
+      Record to write
+    first: input
+      Whether the record is the first one of its frame, which then gets the number of symbols found
+*/
+void printRecord(ostream& out, const logRecord& r, bool first);
+
+
+
+/*
+  readLog
+  Function reading the header of a binary log
+    in: input output
+      Stream opened on the log, in binary mode, left at the first record
+    start: output
+      System time at which the log was opened, in microseconds since the epoch
+    Returns if the header is valid
+*/
+bool readLog(istream& in, int64_t& start);
+
+#endif // POSELOG_H
@@ -0,0 +1,123 @@
+#include "opencv2/highgui/highgui.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include "preview.hpp"
+
+
+
+Preview::Preview(const string& name, float rate, bool scene) :
+  _name(name),
+  _period(chrono::duration_cast< chrono::steady_clock::duration >(chrono::duration< double >(rate > 0 ? 1. / rate : 0))),
+  _scene(scene),
+  _fresh(false),
+  _running(false),
+  _shown(0)
+{
+}
+
+
+
+Preview::~Preview()
+{
+  stop();
+}
+
+
+
+bool Preview::start()
+{
+  if (_running)
+    return false;
+
+  _running = true;
+  _showThread = thread(&Preview::show, this);
+  return true;
+}
+
+
+
+void Preview::stop()
+{
+  {
+    lock_guard<mutex> guard(_lock);
+    _running = false;
+  }
+  _pendingCond.notify_all();
+
+  if (_showThread.joinable())
+    _showThread.join();
+}
+
+
+
+bool Preview::offer(const Mat& image, const vector< qrSymbol >& symbols)
+{
+  chrono::steady_clock::time_point now = chrono::steady_clock::now();
+  if (now < _next)
+    return false;
+
+  // Skip the image rather than wait for the visualization thread
+  unique_lock<mutex> lock(_lock, try_to_lock);
+  if (! (lock.owns_lock() && _running) )
+    return false;
+
+  image.copyTo(_pending);
+  _pendingSymbols = symbols;
+  _fresh = true;
+  _next = now + _period;
+  lock.unlock();
+
+  _pendingCond.notify_one();
+  return true;
+}
+
+
+
+unsigned long Preview::getShown()
+{
+  lock_guard<mutex> guard(_lock);
+  return _shown;
+}
+
+
+
+void Preview::show()
+{
+  Scalar color(0, 0, 255); // BGR pure red to highlight detected symbols
+  namedWindow(_name, 1);
+
+  while (true) {
+    bool fresh = false;
+    {
+      // Wake up at least every few tens of milliseconds, so that the window keeps responding between images
+      unique_lock<mutex> lock(_lock);
+      _pendingCond.wait_for(lock, chrono::milliseconds(30), [this]{ return _fresh || !_running; });
+      if (!_running)
+        break;
+
+      if (_fresh) {
+        swap(_image, _pending);
+        _symbols.swap(_pendingSymbols);
+        _fresh = false;
+        fresh = true;
+      }
+    }
+
+    if (fresh) {
+      if (_image.channels() == 1)
+        cvtColor(_image, _canvas, CV_GRAY2BGR);
+      else
+        swap(_canvas, _image); // Owned by this thread, drawn on directly
+
+      for (size_t s = 0; s < _symbols.size(); s++)
+        drawSymbol(_canvas, _symbols[s], color, _scene);
+      imshow(_name, _canvas);
+
+      lock_guard<mutex> guard(_lock);
+      _shown++;
+    }
+    waitKey(1); // Allows the HighGUI events to be processed
+  }
+
+  destroyWindow(_name);
+}
@@ -0,0 +1,91 @@
+#ifndef PREVIEW_H
+#define PREVIEW_H
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "opencv2/core/core.hpp"
+
+#include "symbols.hpp"
+
+using namespace std;
+using namespace cv;
+
+
+
+/*
+  Preview
+  Class showing the found symbols in a window from a dedicated visualization thread
+  The scan loop offers its images at every frame, but only one is copied per period, and none while the thread is busy:
+  drawing, showing and processing the HighGUI events never delay the loop
+  Every HighGUI call happens on the visualization thread, including the window creation
+*/
+class Preview
+{
+public:
+  /*
+    name: input
+      Title of the window
+    rate: input
+      Largest number of images shown per second
+    scene: input
+      Whether the images offered are the scene plane, in which case the symbols' corners are drawn instead of their location points
+  */
+  Preview(const string& name, float rate = 10, bool scene = false);
+  ~Preview();
+
+  /*
+    start
+    Function opening the window and launching the visualization thread
+    Returns if the thread could be launched
+  */
+  bool start();
+
+  /*
+    stop
+    Function stopping the visualization thread, closing the window and waiting for it to end
+  */
+  void stop();
+
+  /*
+    offer
+    Function handing an image and its symbols over to the visualization thread, never blocks
+      image: input
+        Grayscale or BGR image in which the symbols are located, copied only if it is going to be shown
+      symbols: input
+        Symbols to highlight, only their location points, or their corners on the scene plane, are used
+      Returns whether the image was taken, false if the last one is too recent or is still being shown
+  */
+  bool offer(const Mat& image, const vector< qrSymbol >& symbols);
+
+  // Number of images taken and shown
+  unsigned long getShown();
+
+private:
+  // Visualization thread main loop
+  void show();
+
+  string _name;
+  chrono::steady_clock::duration _period;
+  bool _scene; // Images are the scene plane, whatever the space the symbols were found in
+  chrono::steady_clock::time_point _next; // Earliest time of the next image taken, only used by the scan loop
+
+  Mat _pending;                      // Image taken from the scan loop, not shown yet
+  vector< qrSymbol > _pendingSymbols;
+  Mat _image, _canvas;               // Image being shown, and its color copy to draw on
+  vector< qrSymbol > _symbols;
+
+  thread _showThread;
+  mutex _lock; // Guards the pending image and the state below, never held while drawing or showing
+  condition_variable _pendingCond; // Signaled when an image is pending or the thread must stop
+  bool _fresh;   // The pending image was not shown yet
+  bool _running; // The visualization thread should keep going
+
+  unsigned long _shown;
+};
+
+#endif // PREVIEW_H
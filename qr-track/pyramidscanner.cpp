@@ -0,0 +1,132 @@
+#include <algorithm>
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include "pyramidscanner.hpp"
+
+
+
+PyramidScanner::PyramidScanner(int levels, int margin) :
+  _levels(levels > 0 ? levels : 1),
+  _scale(1 << _levels),
+  _margin(margin),
+  _retried(0),
+  _scanned(0)
+{
+}
+
+
+
+int PyramidScanner::scan(ImageScanner& scanner, const Mat& gray, vector< qrSymbol >& symbols)
+{
+  downscale(gray);
+  scanSymbols(scanner, _coarse, symbols);
+  _scanned = _coarse.total();
+  for (size_t s = 0; s < symbols.size(); s++)
+    refine(gray, symbols[s]);
+
+  // Retry at full resolution the symbols of the previous frame that the coarse level missed
+  _retried = 0;
+  Rect bounds(0, 0, gray.cols, gray.rows);
+  for (map< string, Rect >::iterator k = _known.begin(); k != _known.end(); ++k) {
+    bool found = false;
+    for (size_t s = 0; (s < symbols.size()) && !found; s++)
+      found = (symbols[s].data == k->first);
+    if (found)
+      continue;
+
+    Rect window = Rect(k->second.x - _margin, k->second.y - _margin,
+                       k->second.width + 2 * _margin, k->second.height + 2 * _margin) & bounds;
+    if (window.area() <= 0)
+      continue;
+
+    gray(window).copyTo(_buffer);
+    scanSymbols(scanner, _buffer, _found, Point2f(window.x, window.y));
+    _scanned += _buffer.total();
+    for (size_t f = 0; f < _found.size(); f++) {
+      bool known = false; // Another symbol may lie within the window, keep a single copy of each
+      for (size_t s = 0; (s < symbols.size()) && !known; s++)
+        known = (symbols[s].data == _found[f].data);
+      if (!known) {
+        symbols.push_back(_found[f]);
+        _retried++;
+      }
+    }
+  }
+
+  // Remember where the symbols lie, those found at neither level are forgotten
+  _known.clear();
+  for (size_t s = 0; s < symbols.size(); s++) {
+    const vector< Point2f >& loc = symbols[s].location;
+    if (loc.empty())
+      continue;
+
+    float xmin = loc[0].x, xmax = loc[0].x, ymin = loc[0].y, ymax = loc[0].y;
+    for (size_t i = 1; i < loc.size(); i++) {
+      xmin = min(xmin, loc[i].x);
+      xmax = max(xmax, loc[i].x);
+      ymin = min(ymin, loc[i].y);
+      ymax = max(ymax, loc[i].y);
+    }
+    _known[symbols[s].data] = Rect(Point(cvFloor(xmin), cvFloor(ymin)), Point(cvFloor(xmax) + 1, cvFloor(ymax) + 1));
+  }
+
+  return symbols.size();
+}
+
+
+
+int PyramidScanner::scanWindow(ImageScanner& scanner, const Mat& gray, Rect window, vector< qrSymbol >& symbols)
+{
+  downscale(gray(window));
+  scanSymbols(scanner, _coarse, symbols);
+  _scanned = _coarse.total();
+
+  for (size_t s = 0; s < symbols.size(); s++)
+    refine(gray, symbols[s], Point2f(window.x, window.y));
+  return symbols.size();
+}
+
+
+
+void PyramidScanner::downscale(const Mat& gray)
+{
+  // Coarse level, each pyrDown smoothes then halves the image
+  pyrDown(gray, _coarse);
+  for (int l = 1; l < _levels; l++)
+    pyrDown(_coarse, _coarse);
+}
+
+
+
+void PyramidScanner::refine(const Mat& gray, qrSymbol& symbol, Point2f offset) const
+{
+  if (symbol.location.empty())
+    return;
+
+  // Coarse pixel centers map to the middle of the full resolution pixels they were averaged from
+  for (size_t i = 0; i < symbol.location.size(); i++)
+    symbol.location[i] = Point2f((symbol.location[i].x + 0.5f) * _scale - 0.5f + offset.x,
+                                 (symbol.location[i].y + 0.5f) * _scale - 0.5f + offset.y);
+
+  // The location points are the outer corners of the symbol, sharp enough for a sub-pixel search
+  // The window spans a coarse pixel on each side, the most the scaled points may be off by
+  int half = (int) _scale + 1;
+  cornerSubPix(gray, symbol.location, Size(half, half), Size(-1, -1),
+               TermCriteria(CV_TERMCRIT_ITER | CV_TERMCRIT_EPS, 20, 0.03));
+  symbol.corners = symbol.location;
+}
+
+
+
+int PyramidScanner::getRetried() const
+{
+  return _retried;
+}
+
+
+
+long PyramidScanner::getScanned() const
+{
+  return _scanned;
+}
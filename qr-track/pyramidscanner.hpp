@@ -0,0 +1,92 @@
+#ifndef PYRAMIDSCANNER_H
+#define PYRAMIDSCANNER_H
+
+#include <map>
+#include <vector>
+#include <string>
+
+#include "opencv2/core/core.hpp"
+
+#include <zbar.h>
+
+#include "symbols.hpp"
+
+using namespace std;
+using namespace cv;
+using namespace zbar;
+
+
+
+/*
+  PyramidScanner
+  Class scanning a downscaled copy of the image, then refining the symbols found at full resolution
+  The symbols are large in the scene, so that they still decode at half or quarter resolution, for a fraction of the cost
+  Their location points are scaled back and refined to sub-pixel accuracy within a small full resolution window
+  Symbols found on the previous frame but missed at the coarse level are looked for again at full resolution,
+  only within a window around their last location, those found nowhere are forgotten
+*/
+class PyramidScanner
+{
+public:
+  /*
+    levels: input
+      Number of times the image is halved before scanning, 1 for half resolution, 2 for quarter resolution
+    margin: input
+      Distance in pixels of the full resolution image a symbol may move between two frames
+  */
+  PyramidScanner(int levels, int margin);
+
+  /*
+    scan
+    Function scanning the coarse level of an image, then retrying at full resolution the symbols it missed
+      scanner: input
+        ZBar scanner to use
+      gray: input
+        8-bit grayscale image to scan, at full resolution
+      symbols: output
+        Symbols found, with refined coordinates in the full resolution image
+      Returns the number of symbols found
+  */
+  int scan(ImageScanner& scanner, const Mat& gray, vector< qrSymbol >& symbols);
+
+  /*
+    scanWindow
+    Function scanning the coarse level of a window of an image, without any retry at full resolution
+      scanner: input
+        ZBar scanner to use
+      gray: input
+        8-bit grayscale image, at full resolution
+      window: input
+        Part of the image to scan
+      symbols: output
+        Symbols found, with refined coordinates in the full resolution image
+      Returns the number of symbols found
+  */
+  int scanWindow(ImageScanner& scanner, const Mat& gray, Rect window, vector< qrSymbol >& symbols);
+
+  // Number of symbols of the last scan found only by the full resolution retry
+  int getRetried() const;
+
+  // Number of pixels handed to ZBar by the last scan
+  long getScanned() const;
+
+private:
+  // Function downscaling an image to the coarse level
+  void downscale(const Mat& gray);
+
+  // Function bringing the location points found at the coarse level back into the full resolution image, and refining them
+  void refine(const Mat& gray, qrSymbol& symbol, Point2f offset = Point2f()) const;
+
+  int _levels;
+  float _scale;   // Ratio between the full resolution and the coarse level
+  int _margin;
+  int _retried;
+  long _scanned;
+
+  Mat _coarse;    // Downscaled image, continuous
+  Mat _buffer;    // Continuous copy of the full resolution window being scanned
+  vector< qrSymbol > _found;   // Symbols found in the window being scanned
+  map< string, Rect > _known;  // Full resolution bounds of the symbols found on the previous frame, by data
+};
+
+#endif // PYRAMIDSCANNER_H
@@ -0,0 +1,277 @@
+#include <iostream> // Console outputs
+#include <vector>
+#include <string>
+#include <stdlib.h>
+using namespace std;
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/highgui/highgui.hpp"
+using namespace cv;
+
+#include <zbar.h>
+using namespace zbar;
+
+#include "framesource.hpp"
+#include "pipeline.hpp"
+#include "latency.hpp"
+#include "options.hpp"
+#include "symbols.hpp"
+
+#include "qr-bench.hpp"
+
+
+
+/*
+  readProj
+  Function importing reprojection data as a transformation matrix from a YML file
+    filename: input
+      Full path and name to the YML file to read, or "-" for the identity transformation
+    M: output
+      OpenCV matrix to return transformation matrix
+    Returns if the data import was successful
+*/
+bool readProj( const char* filename, Mat& M)
+{
+  if (string(filename) == "-") { // Sources already reprojected
+    M = Mat::eye(3, 3, CV_64F);
+    return true;
+  }
+
+  FileStorage fs(filename, FileStorage::READ);
+  if( !fs.isOpened() )
+    return false;
+  
+  FileNode Mn = fs["transform_mat"];
+  if ( Mn.empty() )
+    return false;
+
+  // Get the transformation matrix
+  Mn >> M;
+  return true;
+}
+
+
+
+/*
+  readScene
+  Function importing scene reference data from a YML file
+    filename: input
+      Full path and name to the YML file to read
+    scnsize: output
+      Dimensions of the scene
+    Returns if the data import was successful
+*/
+bool readScene( const char* filename, Size& scnsize)
+{
+  FileStorage fs(filename, FileStorage::READ);
+  if ( !fs.isOpened() )
+    return false;
+  
+  FileNode sizen = fs["Size"];
+  if ( sizen.empty() )
+    return false;
+
+  // Get the scene's dimensions
+  sizen >> scnsize;
+
+  fs.release();
+  return true;
+}
+
+
+
+/*
+  benchFrame
+  Function processing one frame through the pipeline and accounting for it
+    pipeline: input output
+      Pipeline of the run
+    frame: input
+      BGR frame to process
+    clk: input output
+      Clock recording the latency of each stage
+    result: input output
+      Counters of the run
+*/
+void benchFrame(Pipeline& pipeline, const Mat& frame, StageClock& clk, benchResult& result)
+{
+  static vector< qrSymbol > symbols;
+
+  int64 t0 = getTickCount();
+  clk.start();
+  pipeline.process(frame, symbols, clk);
+  clk.end();
+  result.seconds += (getTickCount() - t0) / getTickFrequency();
+
+  result.frames++;
+  result.symbols += symbols.size();
+  result.scanned += pipeline.getScanned();
+}
+
+
+
+/*
+  benchSource
+  Function feeding a whole source to the pipeline as fast as possible
+    pipeline: input output
+      Pipeline of the run
+    source: input
+      Full path to an image file, processed repeatedly, or to an AVI, Y4M or frame file, processed frame by frame
+    repeat: input
+      Number of times an image file is processed
+    luma: input
+      Whether to feed the pipeline with the luma plane only, Y4M files always are
+    clk: input output
+      Clock recording the latency of each stage
+    result: input output
+      Counters of the run
+    Returns if the source could be opened
+*/
+bool benchSource(Pipeline& pipeline, const string& source, int repeat, bool luma, StageClock& clk, benchResult& result)
+{
+  Mat frame;
+  string ext = source.substr(source.find_last_of(".") + 1);
+
+  if ( (ext == "avi") || (ext == "y4m") || (ext == "qrf") ) {
+    Ptr< FrameSource > frames = openFileSource(source, luma);
+    if (! frames->isOpened() )
+      return false;
+
+    // Decoding is left out of the measures, only the pipeline is timed
+    while (frames->read(frame))
+      benchFrame(pipeline, frame, clk, result);
+  }
+  else {
+    frame = imread(source, luma ? CV_LOAD_IMAGE_GRAYSCALE : CV_LOAD_IMAGE_COLOR);
+    if (frame.empty())
+      return false;
+
+    for (int i = 0; i < repeat; i++)
+      benchFrame(pipeline, frame, clk, result);
+  }
+
+  return true;
+}
+
+
+
+/*
+  printResult
+  Function writing the throughput of a run in the console
+    name: input
+      Name of the run
+    result: input
+      Counters of the run
+*/
+void printResult(const string& name, const benchResult& result)
+{
+  cout << name << ": " << result.frames << " frame(s) in " << result.seconds << " s - "
+       << (result.seconds > 0 ? result.frames / result.seconds : 0) << " frames/s - "
+       << result.symbols << " symbol(s) decoded - "
+       << (result.frames > 0 ? result.scanned / result.frames : 0) << " pixels scanned per frame" << endl;
+}
+
+
+
+#define param 3
+#define bound "# -----------------------------------"
+
+int main(int args, char* argv[])
+{
+  // Sources run until the first option
+  int first = param;
+  while ( (first < args) && (string(argv[first]).compare(0, 2, "--") != 0) )
+    first++;
+
+  // Benchmark options are taken out, the others are tracking options
+  int repeat = 100;
+  bool checkShed = false;
+  vector< char* > trackargs(argv, argv + first);
+  bool args_OK = true;
+  for (int i = first; i < args; i++) {
+    if (string(argv[i]) == "--repeat") {
+      args_OK = args_OK && (i + 1 < args) && ( (repeat = atoi(argv[i + 1])) > 0 );
+      i++;
+    }
+    else if (string(argv[i]) == "--check-shed")
+      checkShed = true;
+    else
+      trackargs.push_back(argv[i]);
+  }
+
+  trackOptions opts;
+  if ( (first < param + 1) || !args_OK || !readOptions(trackargs.size(), trackargs.data(), first, opts) ) {
+    cerr << "Usage: qr-bench <calib-data.yml | -> <scn-data.yml> <source> [<source>...] [--repeat <n>] [--check-shed] [options]" << endl
+         << "  Sources are image files, processed <n> times each (default: 100), or AVI, Y4M or frame (.qrf) files, processed frame by frame" << endl
+         << "  Give - as calibration data for sources already reprojected" << endl
+         << "  --check-shed runs each source at every load shedding level of the pipeline, and fails unless each level scans fewer pixels" << endl
+         << optionsUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  cout << bound << endl << "QR tracker offline benchmark" << endl << endl;
+
+  Mat M;
+  Size scnsize;
+  bool proj_loaded = readProj(argv[1], M);
+  cout << ( proj_loaded ? "Reprojection data successfully loaded from: " : "Failed to load reprojection data from: ") << argv[1] << endl;
+  bool scn_loaded = readScene(argv[2], scnsize);
+  cout << ( scn_loaded ? "Scene data successfully loaded from: " : "Failed to load scene data from: ") << argv[2] << endl;
+  if (! (proj_loaded && scn_loaded) ) {
+    cerr << endl << bound << endl << "Aborting benchmark..." << endl;
+    exit(EXIT_FAILURE);
+  }
+  cout << bound << endl << endl;
+
+  LatencyStats stats;
+  StageClock clk(stats);
+  benchResult total;
+  int status = EXIT_SUCCESS;
+
+  // The levels past SHED_TRACKED are applied by the tracking loop, not by the pipeline
+  int levels = checkShed ? SHED_TRACKED + 1 : 1;
+  if (checkShed && (opts.budget <= 0))
+    opts.budget = 1; // The coarser level is only prepared when load may be shed
+
+  for (int s = param; s < first; s++) {
+    double previous = -1; // Pixels scanned per frame at the previous level
+    for (int level = SHED_NONE; level < levels; level++) {
+      Pipeline pipeline(M, scnsize, opts); // Fresh state for each source, tracked windows do not carry over
+      pipeline.shed(level);
+      benchResult result;
+      string name = checkShed ? string(argv[s]) + " at shed level " + to_string(level) : string(argv[s]);
+
+      if (benchSource(pipeline, argv[s], repeat, opts.luma, clk, result))
+        printResult(name, result);
+      else {
+        cerr << "Failed to open source: " << argv[s] << endl;
+        status = EXIT_FAILURE;
+        break;
+      }
+
+      if (checkShed && (result.frames > 0)) {
+        double scanned = result.scanned / result.frames;
+        if ( (previous >= 0) && (scanned >= previous) ) {
+          cerr << name << " scans " << scanned << " pixels per frame, no fewer than the " << previous << " of the level below" << endl;
+          status = EXIT_FAILURE;
+        }
+        previous = scanned;
+      }
+
+      total.frames += result.frames;
+      total.symbols += result.symbols;
+      total.seconds += result.seconds;
+      total.scanned += result.scanned;
+    }
+  }
+
+  cout << endl;
+  printResult("Total", total);
+  stats.print(cout);
+
+  if (! opts.latencyfile.empty() ) {
+    bool saved = stats.save(opts.latencyfile);
+    cout << (saved ? "Latency report successfully saved at: " : "Failed to save latency report at: ") << opts.latencyfile << endl;
+  }
+
+  return status;
+}
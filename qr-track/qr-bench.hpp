@@ -0,0 +1,91 @@
+using namespace std;
+using namespace cv;
+using namespace zbar;
+
+
+
+/*
+  benchResult
+  Structure gathering the counters of a benchmark run
+*/
+struct benchResult {
+  unsigned long frames = 0;  // Number of frames processed
+  unsigned long symbols = 0; // Number of symbols decoded
+  double seconds = 0;        // Time spent in the pipeline
+  double scanned = 0;        // Number of pixels handed to ZBar
+};
+
+
+
+/*
+  readProj
+  Function importing reprojection data as a transformation matrix from a YML file
+    filename: input
+      Full path and name to the YML file to read, or "-" for the identity transformation
+    M: output
+      OpenCV matrix to return transformation matrix
+    Returns if the data import was successful
+*/
+bool readProj( const char* filename, Mat& M);
+
+
+
+/*
+  readScene
+  Function importing scene reference data from a YML file
+    filename: input
+      Full path and name to the YML file to read
+    scnsize: output
+      Dimensions of the scene
+    Returns if the data import was successful
+*/
+bool readScene( const char* filename, Size& scnsize);
+
+
+
+/*
+  benchFrame
+  Function processing one frame through the pipeline and accounting for it
+    pipeline: input output
+      Pipeline of the run
+    frame: input
+      BGR frame to process
+    clk: input output
+      Clock recording the latency of each stage
+    result: input output
+      Counters of the run
+*/
+void benchFrame(Pipeline& pipeline, const Mat& frame, StageClock& clk, benchResult& result);
+
+
+
+/*
+  benchSource
+  Function feeding a whole source to the pipeline as fast as possible
+    pipeline: input output
+      Pipeline of the run
+    source: input
+      Full path to an image file, processed repeatedly, or to an AVI, Y4M or frame file, processed frame by frame
+    repeat: input
+      Number of times an image file is processed
+    luma: input
+      Whether to feed the pipeline with the luma plane only, Y4M files always are
+    clk: input output
+      Clock recording the latency of each stage
+    result: input output
+      Counters of the run
+    Returns if the source could be opened
+*/
+bool benchSource(Pipeline& pipeline, const string& source, int repeat, bool luma, StageClock& clk, benchResult& result);
+
+
+
+/*
+  printResult
+  Function writing the throughput of a run in the console
+    name: input
+      Name of the run
+    result: input
+      Counters of the run
+*/
+void printResult(const string& name, const benchResult& result);
@@ -0,0 +1,339 @@
+#include <iostream> // Console outputs
+#include <sstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <math.h>
+#include <stdlib.h>
+#include <unistd.h>
+using namespace std;
+
+#include "poselog.hpp"
+#include "trajectory.hpp"
+#include "workpool.hpp"
+
+#include "qr-check.hpp"
+
+// Synthetic run: frames, Metabot IDs, time between two frames in microseconds
+#define checkFrames 300
+#define checkIDs 6
+#define checkPeriod 10000
+
+// Ring of the pose log, small enough for the writer thread to fall behind
+#define checkRing 64
+
+// Trajectory block span and quantization
+#define checkInterval 1000000
+#define checkQuantum 0.1f
+
+
+
+/*
+  checkPose
+  Structure of a pose of the synthetic run
+*/
+struct checkPose {
+  int64_t stamp; // Capture time, in microseconds since the first frame
+  int ID;
+  float x;
+  float y;
+  float angle;
+};
+
+
+
+/*
+  synthPresent
+  Function telling if a Metabot is found in a frame of the synthetic run, every 25th frame is empty
+*/
+static bool synthPresent(int frame, int ID)
+{
+  return (frame % 25 != 0) && ((frame + ID) % 3 != 0);
+}
+
+
+
+/*
+  synthFrames
+  Function gathering the synthetic poses within a frame range and an ID range, ordered by time then ID
+*/
+static vector< checkPose > synthFrames(int first, int last, int minID, int maxID)
+{
+  vector< checkPose > poses;
+  for(int f = first; f <= last; f++)
+    for(int ID = max(minID, 1); ID <= min(maxID, checkIDs); ID++)
+      if (synthPresent(f, ID)) {
+        checkPose p;
+        p.stamp = (int64_t) f * checkPeriod;
+        p.ID = ID;
+        p.x = 10 * ID + 0.37f * f;
+        p.y = -5 * ID + 0.11f * f;
+        p.angle = fmodf(7 * f + 30 * ID, 360) - 180;
+        poses.push_back(p);
+      }
+  return poses;
+}
+
+
+
+bool writeLog(const char* filename)
+{
+  PoseLog log(filename, "", checkRing);
+  if (! log.start() ) {
+    cerr << "Failed to create pose log: " << filename << endl;
+    return false;
+  }
+
+  PoseLog::clock::time_point t0 = PoseLog::clock::now();
+  unsigned long records = 0;
+  for(int f = 0; f < checkFrames; f++) {
+    vector< checkPose > frame = synthFrames(f, f, INT_MIN, INT_MAX);
+    log.beginFrame(t0 + chrono::microseconds((int64_t) f * checkPeriod), frame.size());
+    for(size_t s = 0; s < frame.size(); s++)
+      log.record(frame[s].ID, Point2f(frame[s].x, frame[s].y), frame[s].angle);
+    records += frame.empty() ? 1 : frame.size();
+
+    // The first half at a pace the writer thread keeps up with, the second half in a burst overflowing the ring
+    if (f < checkFrames / 2)
+      this_thread::sleep_for(chrono::milliseconds(1));
+  }
+  log.stop();
+
+  // Records written include the ones accounting for the drops
+  cout << records << " record(s) logged, " << log.getDropped() << " dropped by the ring" << endl;
+  if (log.getWritten() + log.getDropped() < records) {
+    cerr << "Pose log: " << log.getWritten() << " record(s) written and " << log.getDropped() << " dropped, " << records << " logged" << endl;
+    return false;
+  }
+  return true;
+}
+
+
+
+bool checkLog(istream& in)
+{
+  string line;
+  if (! (getline(in, line) && (line == "frame,time_us,symbols,id,x,y,angle")) ) {
+    cerr << "Pose log: missing CSV header" << endl;
+    return false;
+  }
+
+  // One record per pose, or a single record with ID -1 for an empty frame
+  vector< logRecord > expected;
+  for(int f = 0; f < checkFrames; f++) {
+    vector< checkPose > frame = synthFrames(f, f, INT_MIN, INT_MAX);
+    logRecord r;
+    r.stamp = (int64_t) f * checkPeriod;
+    r.frame = f;
+    r.count = frame.size();
+    r.ID = LOG_EMPTY;
+    r.x = r.y = r.angle = 0;
+    if (frame.empty())
+      expected.push_back(r);
+    for(size_t s = 0; s < frame.size(); s++) {
+      r.ID = frame[s].ID;
+      r.x = frame[s].x;
+      r.y = frame[s].y;
+      r.angle = frame[s].angle;
+      expected.push_back(r);
+    }
+  }
+
+  // Stamps are relative to the opening of the log, only their differences are known
+  size_t rows = 0, next = 0, kept = 0;
+  unsigned long dropped = 0;
+  int64_t origin = -1;
+  while (getline(in, line)) {
+    istringstream row(line);
+    logRecord r;
+    char comma;
+    if (! (row >> r.frame >> comma >> r.stamp >> comma >> r.count >> comma >> r.ID >> comma >> r.x >> comma >> r.y >> comma >> r.angle) ) {
+      cerr << "Pose log: unreadable row " << rows << ": " << line << endl;
+      return false;
+    }
+    rows++;
+
+    if (r.ID == LOG_DROPPED) {
+      dropped += r.count;
+      continue;
+    }
+
+    // The records dropped since the previous one kept are accounted for just before it
+    size_t skipped = 0;
+    while ( (next < expected.size()) && ((expected[next].frame != r.frame) || (expected[next].ID != r.ID)) ) {
+      next++;
+      skipped++;
+    }
+    if (next == expected.size()) {
+      cerr << "Pose log: row " << rows - 1 << " was never logged, or out of order: " << line << endl;
+      return false;
+    }
+    if (skipped != dropped) {
+      cerr << "Pose log: " << skipped << " record(s) missing before row " << rows - 1 << ", " << dropped << " counted as dropped" << endl;
+      return false;
+    }
+    dropped = 0;
+
+    const logRecord& e = expected[next++];
+    if (origin < 0)
+      origin = r.stamp - e.stamp;
+    if ( (r.stamp - origin != e.stamp) || (r.count != e.count) ||
+         (fabsf(r.x - e.x) > 1e-3f) || (fabsf(r.y - e.y) > 1e-3f) || (fabsf(r.angle - e.angle) > 1e-3f) ) {
+      cerr << "Pose log: row " << rows - 1 << " decoded as " << line << endl;
+      return false;
+    }
+    kept++;
+  }
+
+  if (expected.size() - next != dropped) {
+    cerr << "Pose log: " << expected.size() - next << " record(s) missing at the end, " << dropped << " counted as dropped" << endl;
+    return false;
+  }
+  cout << kept << " record(s) decoded, " << expected.size() - kept << " accounted for as dropped" << endl;
+  return true;
+}
+
+
+
+/*
+  samePoses
+  Function comparing decoded poses with the expected ones, up to the quantization
+*/
+static bool samePoses(const char* query, const vector< trajPose >& found, const vector< checkPose >& expected, float quantum)
+{
+  if (found.size() != expected.size()) {
+    cerr << query << ": " << found.size() << " pose(s) found, " << expected.size() << " expected" << endl;
+    return false;
+  }
+
+  float tolerance = quantum / 2 + 1e-3f;
+  for(size_t i = 0; i < found.size(); i++) {
+    const trajPose& f = found[i];
+    const checkPose& e = expected[i];
+    if ( (f.stamp != e.stamp) || (f.ID != e.ID) || (fabsf(f.x - e.x) > tolerance) || (fabsf(f.y - e.y) > tolerance) || (fabsf(f.angle - e.angle) > tolerance) ) {
+      cerr << query << ": pose " << i << " decoded as " << f.ID << " (" << f.x << ", " << f.y << ", " << f.angle << ") at " << f.stamp
+           << " us, expected " << e.ID << " (" << e.x << ", " << e.y << ", " << e.angle << ") at " << e.stamp << " us" << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+
+
+bool checkTrajectory(const char* filename)
+{
+  TrajectoryWriter writer(checkInterval, checkQuantum, checkQuantum);
+  if (! writer.open(filename, 0) ) {
+    cerr << "Failed to create trajectory: " << filename << endl;
+    return false;
+  }
+  for(int f = 0; f < checkFrames; f++) {
+    writer.beginFrame((int64_t) f * checkPeriod);
+    vector< checkPose > frame = synthFrames(f, f, INT_MIN, INT_MAX);
+    for(size_t s = 0; s < frame.size(); s++)
+      writer.add(frame[s].ID, frame[s].x, frame[s].y, frame[s].angle);
+  }
+  writer.close();
+
+  TrajectoryReader reader;
+  if (! reader.open(filename) ) {
+    cerr << "Failed to read trajectory back from: " << filename << endl;
+    return false;
+  }
+
+  int perBlock = checkInterval / checkPeriod;
+  int blocks = (checkFrames + perBlock - 1) / perBlock;
+  if ((int) reader.getBlocks().size() != blocks) {
+    cerr << "Trajectory: " << reader.getBlocks().size() << " block(s) indexed, " << blocks << " expected" << endl;
+    return false;
+  }
+
+  vector< trajPose > poses;
+  reader.read(0, INT64_MAX, INT_MIN, INT_MAX, poses);
+  bool OK = samePoses("Whole trajectory", poses, synthFrames(0, checkFrames - 1, INT_MIN, INT_MAX), checkQuantum);
+
+  // Span overlapping two blocks, bounds included
+  reader.read(50 * checkPeriod, 150 * checkPeriod, 2, 3, poses);
+  OK &= samePoses("Span and ID range", poses, synthFrames(50, 150, 2, 3), checkQuantum);
+
+  // Between two frames, and on an empty frame
+  OK &= reader.frameAt(123 * checkPeriod + checkPeriod / 2, poses) && samePoses("Frame at", poses, synthFrames(123, 123, INT_MIN, INT_MAX), checkQuantum);
+  OK &= reader.frameAt(150 * checkPeriod, poses) && poses.empty();
+  reader.close();
+
+  // A crash while appending the last block
+  TrajectoryReader truncated;
+  if ( (truncate(filename, writer.getBytes() - 1) != 0) || !truncated.open(filename) ) {
+    cerr << "Failed to read truncated trajectory: " << filename << endl;
+    return false;
+  }
+  truncated.read(0, INT64_MAX, INT_MIN, INT_MAX, poses);
+  OK &= samePoses("Truncated trajectory", poses, synthFrames(0, (blocks - 1) * perBlock - 1, INT_MIN, INT_MAX), checkQuantum);
+
+  return OK;
+}
+
+
+
+bool checkPool()
+{
+  bool OK = true;
+  const long tasks = 1000;
+
+  // Every task submits a continuation from its worker, stop must run them all
+  WorkPool pool(4);
+  atomic< long > done(0);
+  for(long t = 0; t < tasks; t++)
+    pool.submit([&pool, &done]() {
+      done++;
+      pool.submit([&done]() { done++; });
+    });
+  pool.stop();
+
+  if ( (done != 2 * tasks) || (pool.getExecuted() != (unsigned long) (2 * tasks)) ) {
+    cerr << "Work pool: " << done << " task(s) run and " << pool.getExecuted() << " counted before stopping, " << 2 * tasks << " expected" << endl;
+    OK = false;
+  }
+
+  // Stopping twice, and stopping an idle pool, must return
+  pool.stop();
+  WorkPool idle(2);
+  idle.stop();
+
+  return OK;
+}
+
+
+
+int main(int args, char* argv[])
+{
+  string check = (args > 1) ? argv[1] : "";
+  bool OK;
+  if ( (check == "log") && (args == 3) )
+    OK = writeLog(argv[2]);
+  else if ( (check == "decoded") && (args == 2) )
+    OK = checkLog(cin);
+  else if ( (check == "trajectory") && (args == 3) )
+    OK = checkTrajectory(argv[2]);
+  else if ( (check == "pool") && (args == 2) )
+    OK = checkPool();
+  else {
+    cerr << "Usage: qr-check log <pose-log>" << endl
+         << "       qr-log <pose-log> --csv | qr-check decoded" << endl
+         << "       qr-check trajectory <trajectory>" << endl
+         << "       qr-check pool" << endl
+         << "  Checks the parts of the trackers that need no camera, make run-check runs them all" << endl
+         << "  log          Writes a synthetic pose log through a ring small enough to drop records" << endl
+         << "  decoded      Checks that qr-log decodes that log as written, gaps accounted for as dropped" << endl
+         << "  trajectory   Writes a synthetic trajectory and checks every query, then a truncated last block" << endl
+         << "  pool         Checks that the work pool runs every task queued, including continuations, before stopping" << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  cout << "Check " << check << ": " << (OK ? "OK" : "FAILED") << endl;
+  return OK ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,45 @@
+using namespace std;
+
+
+
+/*
+  writeLog
+  Function writing a synthetic pose log through a ring small enough to drop records, checked then by checkLog
+    filename: input
+      Full path and name of the log to write
+    Returns if the log could be written and every record was either written or counted as dropped
+*/
+bool writeLog(const char* filename);
+
+
+
+/*
+  checkLog
+  Function checking the CSV decoding of the log written by writeLog, as output by qr-log --csv
+  The records kept must be the synthetic ones in order, and each gap must be accounted for by a dropped record
+    in: input output
+      Stream to read the CSV from
+    Returns if every record was decoded as written
+*/
+bool checkLog(istream& in);
+
+
+
+/*
+  checkTrajectory
+  Function writing a synthetic trajectory over several blocks, then checking that every query decodes it back
+  within a quantum, and that a block cut short is ignored
+    filename: input
+      Full path and name of the trajectory file to write, truncated by the check
+    Returns if every check passed
+*/
+bool checkTrajectory(const char* filename);
+
+
+
+/*
+  checkPool
+  Function checking that a work pool runs every task, including the ones submitted by tasks, before stopping
+    Returns if every check passed
+*/
+bool checkPool();
@@ -0,0 +1,79 @@
+#include <iostream> // Console outputs
+#include <fstream>
+#include <string>
+#include <stdlib.h>
+using namespace std;
+
+#include "poselog.hpp"
+
+#include "qr-log.hpp"
+
+
+
+/*
+  decodeLog
+  Function writing the records of a binary pose log as text or CSV
+    filename: input
+      Full path and name to the binary log to read
+    csv: input
+      Whether to write one CSV row per record, with a header row, instead of the console form of the tracker
+    out: input output
+      Stream to write into
+    Returns the number of records decoded, -1 if the file could not be opened or is not a pose log
+*/
+long decodeLog(const char* filename, bool csv, ostream& out)
+{
+  ifstream in(filename, ios::in | ios::binary);
+  int64_t start = 0;
+  if (! (in.is_open() && readLog(in, start)) )
+    return -1;
+
+  if (csv)
+    out << "frame,time_us,symbols,id,x,y,angle" << '\n';
+  else
+    out << "Log opened at " << start << " us since the epoch" << '\n';
+
+  logRecord r;
+  long records = 0;
+  unsigned long dropped = 0;
+  uint32_t frame = 0;
+  bool first = true;
+  while (in.read((char*) &r, sizeof(r))) {
+    records++;
+    if (r.ID == LOG_DROPPED)
+      dropped += r.count;
+
+    if (csv)
+      out << r.frame << ',' << r.stamp << ',' << r.count << ',' << r.ID << ',' << r.x << ',' << r.y << ',' << r.angle << '\n';
+    else {
+      printRecord(out, r, first || (r.frame != frame));
+      if (r.ID != LOG_DROPPED) {
+        frame = r.frame;
+        first = false;
+      }
+    }
+  }
+
+  if (!csv)
+    out << records << " record(s) decoded, " << dropped << " dropped by the tracker" << endl;
+  return records;
+}
+
+
+
+int main(int args, char* argv[])
+{
+  bool csv = (args == 3) && (string(argv[2]) == "--csv");
+  if ( (args != 2) && !csv ) {
+    cerr << "Usage: qr-log <pose-log> [--csv]" << endl
+         << "  Writes the records of a binary log saved by qr-track or qr-scan with --log, as text or as CSV" << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (decodeLog(argv[1], csv, cout) < 0) {
+    cerr << "Failed to read pose log from: " << argv[1] << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,16 @@
+using namespace std;
+
+
+
+/*
+  decodeLog
+  Function writing the records of a binary pose log as text or CSV
+    filename: input
+      Full path and name to the binary log to read
+    csv: input
+      Whether to write one CSV row per record, with a header row, instead of the console form of the tracker
+    out: input output
+      Stream to write into
+    Returns the number of records decoded, -1 if the file could not be opened or is not a pose log
+*/
+long decodeLog(const char* filename, bool csv, ostream& out);
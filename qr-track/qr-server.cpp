@@ -0,0 +1,247 @@
+#include <iostream> // Console outputs
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <signal.h>
+#include <stdlib.h>
+using namespace std;
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/highgui/highgui.hpp"
+using namespace cv;
+
+#include "framesource.hpp"
+#include "streamserver.hpp"
+#include "latency.hpp"
+#include "options.hpp"
+
+#include "qr-server.hpp"
+
+
+
+/*
+  readProj
+  Function importing reprojection data as a transformation matrix from a YML file
+    filename: input
+      Full path and name to the YML file to read, or "-" for the identity transformation
+    M: output
+      OpenCV matrix to return transformation matrix
+    Returns if the data import was successful
+*/
+bool readProj( const char* filename, Mat& M)
+{
+  if (string(filename) == "-") { // Sources already reprojected
+    M = Mat::eye(3, 3, CV_64F);
+    return true;
+  }
+
+  FileStorage fs(filename, FileStorage::READ);
+  if( !fs.isOpened() )
+    return false;
+  
+  FileNode Mn = fs["transform_mat"];
+  if ( Mn.empty() )
+    return false;
+
+  // Get the transformation matrix
+  Mn >> M;
+  return true;
+}
+
+
+
+/*
+  readScene
+  Function importing scene reference data from a YML file
+    filename: input
+      Full path and name to the YML file to read
+    scnsize: output
+      Dimensions of the scene
+    Returns if the data import was successful
+*/
+bool readScene( const char* filename, Size& scnsize)
+{
+  FileStorage fs(filename, FileStorage::READ);
+  if ( !fs.isOpened() )
+    return false;
+  
+  FileNode sizen = fs["Size"];
+  if ( sizen.empty() )
+    return false;
+
+  // Get the scene's dimensions
+  sizen >> scnsize;
+
+  fs.release();
+  return true;
+}
+
+
+
+/*
+  openStream
+  Function opening the video source of a stream
+    source: input
+      Full path to an AVI, Y4M or frame file, or index of a camera
+    opts: input
+      Options of the run: opts.luma for the luma plane only, opts.realtime to replay frame files at their capture pace
+    frames: output
+      Opened video source, check isOpened
+    live: output
+      Whether the source is a live camera, whose frames may be dropped, or a file to be read entirely
+*/
+void openStream(const string& source, const trackOptions& opts, Ptr< FrameSource >& frames, bool& live)
+{
+  string ext = source.substr(source.find_last_of(".") + 1);
+
+  if (ext == "qrf") {
+    frames = new ReplaySource(source, opts.realtime);
+    live = opts.realtime;
+  }
+  else if ( (ext == "avi") || (ext == "y4m") ) {
+    frames = openFileSource(source, opts.luma);
+    live = false;
+  }
+  else {
+    frames = new CaptureSource(atoi(source.c_str()), opts.luma);
+    live = true;
+  }
+}
+
+
+
+/*
+  loadStream
+  Function loading the reprojection data, the scene and the video source of a stream, as qr-track does for its single one
+    projname: input
+      Full path and name to the YML file from which to get reprojection data
+    scnname: input
+      Full path and name to the YML file from which to get the scene's dimensions
+    source: input
+      Full path to an AVI, Y4M or frame file, or index of a camera
+    opts: input
+      Options of the run
+    M: output
+      Loaded transformation matrix
+    scnsize: output
+      Loaded dimensions of the scene
+    frames: output
+      Opened video source
+    live: output
+      Whether the source is a live camera
+    Returns if the data loading was successful
+*/
+bool loadStream(const char* projname, const char* scnname, const char* source, const trackOptions& opts, Mat& M, Size& scnsize, Ptr< FrameSource >& frames, bool& live)
+{
+  bool proj_loaded = readProj(projname, M);
+  cout << ( proj_loaded ? "Reprojection data successfully loaded from: " : "Failed to load reprojection data from: ") << projname << endl;
+  bool scn_loaded = readScene(scnname, scnsize);
+  cout << ( scn_loaded ? "Scene data successfully loaded from: " : "Failed to load scene data from: ") << scnname << endl;
+
+  openStream(source, opts, frames, live);
+  bool cap_opened = frames->isOpened();
+  cout << ( cap_opened ? "Video source successfully opened: " : "Failed to open video source: ") << source << endl;
+
+  return proj_loaded && scn_loaded && cap_opened;
+}
+
+
+
+/*
+  Ctrl-C interruption handling
+*/
+bool loop_exit = false;
+void interrupt_loop(int sig) // Whenever the user exits with Ctrl-C
+{
+  cout << endl << "Keyboard interruption catched. Terminating program..." << endl;
+  loop_exit = true; // The programs exits the loop cleanly
+}
+
+
+
+#define param 3
+#define bound "# -----------------------------------"
+
+int main(int args, char* argv[])
+{
+  // Streams are given as triples until the first option
+  int first = 1;
+  while ( (first + 2 < args) && (string(argv[first]).compare(0, 2, "--") != 0) )
+    first += 3;
+
+  trackOptions opts;
+  if ( (first < param + 1) || ( (first < args) && (string(argv[first]).compare(0, 2, "--") != 0) ) || !readOptions(args, argv, first, opts) ) {
+    cerr << "Usage: qr-server <calib-data.yml> <scn-data.yml> <video-source> [<calib-data.yml> <scn-data.yml> <video-source>...] [options]" << endl
+         << "  Tracks every stream in a single process, their frames being reprojected and scanned by a shared pool of threads" << endl
+         << "  Video sources are AVI, Y4M or frame (.qrf) files, or camera indices" << endl
+         << "  With --log or --trajectory, the poses of stream s are saved into the given files suffixed with .s" << endl
+         << optionsUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  if ( opts.roi || (opts.budget > 0) ) {
+    cerr << "--roi and --budget follow the frames of a stream one after the other, while the server processes several at once" << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  cout << bound << endl << "QR tracker server for several streams" << endl << endl;
+
+  int nstreams = (first - 1) / param;
+  vector< Ptr< FrameSource > > sources(nstreams);
+  vector< Mat > Ms(nstreams);
+  vector< Size > scnsizes(nstreams);
+  vector< bool > lives(nstreams);
+  bool loaded = true;
+  for (int s = 0; s < nstreams; s++) {
+    bool live = true;
+    loaded = loadStream(argv[1 + s * param], argv[2 + s * param], argv[3 + s * param], opts, Ms[s], scnsizes[s], sources[s], live) && loaded;
+    lives[s] = live;
+  }
+  if (!loaded) {
+    cerr << endl << bound << endl << "Aborting scanning..." << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  setNumThreads(0); // OpenCV's own parallel loops run sequentially, the pool spreads the streams over the cores instead
+
+  LatencyStats stats;
+  StreamServer server(opts, stats);
+  for (int s = 0; s < nstreams; s++)
+    server.addStream(Ms[s], scnsizes[s], *sources[s], lives[s], argv[3 + s * param]);
+
+  signal(SIGINT, interrupt_loop); // Register interruption signal
+  if (! server.start() ) {
+    cerr << "Failed to start any stream!" << endl;
+    exit(EXIT_FAILURE);
+  }
+  cout << nstreams << " streams processed by " << server.getThreads() << " threads" << endl << bound << endl << endl;
+
+  while (!loop_exit && server.isRunning())
+    this_thread::sleep_for(chrono::milliseconds(100));
+  server.stop();
+
+  // Throughput of each stream, and of the whole server over the time it took to process every stream
+  unsigned long frames = 0;
+  double seconds = 0;
+  cout << fixed << setprecision(1);
+  for (int s = 0; s < nstreams; s++) {
+    double t = server.getSeconds(s);
+    cout << "Stream " << s << " (" << argv[3 + s * param] << "): frames captured: " << server.getCaptured(s) << " - processed: " << server.getProcessed(s)
+         << " - dropped: " << server.getDropped(s) << " - symbols: " << server.getSymbols(s) << " - " << (t > 0 ? server.getProcessed(s) / t : 0) << " frames/s" << endl;
+    frames += server.getProcessed(s);
+    seconds = max(seconds, t);
+  }
+  cout << "All streams: " << frames << " frames in " << seconds << " s - " << (seconds > 0 ? frames / seconds : 0) << " frames/s" << endl;
+  cout.unsetf(ios::floatfield);
+  cout << "Tasks run: " << server.getTasks() << " - stolen: " << server.getStolen() << endl;
+
+  stats.print(cout);
+  if (! opts.latencyfile.empty() ) {
+    bool saved = stats.save(opts.latencyfile);
+    cout << (saved ? "Latency report successfully saved at: " : "Failed to save latency report at: ") << opts.latencyfile << endl;
+  }
+
+  return EXIT_SUCCESS;
+}
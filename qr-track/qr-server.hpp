@@ -0,0 +1,69 @@
+using namespace std;
+using namespace cv;
+
+
+
+/*
+  readProj
+  Function importing reprojection data as a transformation matrix from a YML file
+    filename: input
+      Full path and name to the YML file to read, or "-" for the identity transformation
+    M: output
+      OpenCV matrix to return transformation matrix
+    Returns if the data import was successful
+*/
+bool readProj( const char* filename, Mat& M);
+
+
+
+/*
+  readScene
+  Function importing scene reference data from a YML file
+    filename: input
+      Full path and name to the YML file to read
+    scnsize: output
+      Dimensions of the scene
+    Returns if the data import was successful
+*/
+bool readScene( const char* filename, Size& scnsize);
+
+
+
+/*
+  openStream
+  Function opening the video source of a stream
+    source: input
+      Full path to an AVI, Y4M or frame file, or index of a camera
+    opts: input
+      Options of the run: opts.luma for the luma plane only, opts.realtime to replay frame files at their capture pace
+    frames: output
+      Opened video source, check isOpened
+    live: output
+      Whether the source is a live camera, whose frames may be dropped, or a file to be read entirely
+*/
+void openStream(const string& source, const trackOptions& opts, Ptr< FrameSource >& frames, bool& live);
+
+
+
+/*
+  loadStream
+  Function loading the reprojection data, the scene and the video source of a stream, as qr-track does for its single one
+    projname: input
+      Full path and name to the YML file from which to get reprojection data
+    scnname: input
+      Full path and name to the YML file from which to get the scene's dimensions
+    source: input
+      Full path to an AVI, Y4M or frame file, or index of a camera
+    opts: input
+      Options of the run
+    M: output
+      Loaded transformation matrix
+    scnsize: output
+      Loaded dimensions of the scene
+    frames: output
+      Opened video source
+    live: output
+      Whether the source is a live camera
+    Returns if the data loading was successful
+*/
+bool loadStream(const char* projname, const char* scnname, const char* source, const trackOptions& opts, Mat& M, Size& scnsize, Ptr< FrameSource >& frames, bool& live);
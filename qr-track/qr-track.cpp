@@ -1,9 +1,8 @@
 #include <iostream> // Console outputs
 #include <vector>
 #include <string>
+#include <stdlib.h> // atoi
 #include <signal.h> // Keyboard interruption
-#include <math.h>   // atan2
-#define PI 3.1415927 
 using namespace std;
 
 #include "opencv2/core/core.hpp"
@@ -16,6 +15,21 @@ using namespace cv;
 #include <zbar.h>
 using namespace zbar;
 
+#include "framesource.hpp"
+#include "framegrabber.hpp"
+#include "camerafusion.hpp"
+#include "pipeline.hpp"
+#include "latency.hpp"
+#include "options.hpp"
+#include "symbols.hpp"
+#include "roitracker.hpp"
+#include "tilescanner.hpp"
+#include "pyramidscanner.hpp"
+#include "warpmap.hpp"
+#include "preview.hpp"
+#include "poselog.hpp"
+#include "driftmonitor.hpp"
+
 #include "qr-track.hpp"
 
 
@@ -109,22 +123,24 @@ bool readScene( const char* filename, Size& scnsize)
 /*
   openCam
   Function attempting to connect to a camera at up to ten different indices
-    videocap: output
-      VideoCapture object corresponding to the first found camera
+    source: output
+      Frame source corresponding to the first found camera
     index: input output
       As input: first camera index to try
       As output: last camera index tried, index of the first found camera if applicable
+    luma: input
+      Whether the camera should deliver the luma plane only
     Returns if the program could connect to a camera
 */
-bool openCam(VideoCapture& videocap, int& index)
+bool openCam(Ptr< FrameSource >& source, int& index, bool luma)
 {
   bool opened = false;
   int maxindex = index + 10;
 
   // Try to open a camera among the ten first found
   while (!opened && (index < maxindex)) {
-    videocap = VideoCapture(index);
-    opened = videocap.isOpened();
+    source = new CaptureSource(index, luma);
+    opened = source->isOpened();
     index++;
   }
 
@@ -138,59 +154,108 @@ bool openCam(VideoCapture& videocap, int& index)
 /*
   openAVI
   Function attempting to open an AVI video file
-    videocap: output
-      VideoCapture object corresponding to the opened file
+    source: output
+      Frame source corresponding to the opened file
     path: input
       Full path and name to the AVI file to open
+    luma: input
+      Whether the file should deliver the luma plane only
     Returns if the program could open the video file
 */
-bool openAVI(VideoCapture& videocap, char* path)
+bool openAVI(Ptr< FrameSource >& source, const char* path, bool luma)
 {
-  videocap = VideoCapture(path);
-  return videocap.isOpened();
+  source = new CaptureSource(path, luma);
+  return source->isOpened();
 }
 
 
 
 /*
-  loadData
-  Function loading and checking all required data
+  openY4M
+  Function attempting to open a YUV4MPEG2 video file, whose luma plane is read directly
+    source: output
+      Frame source corresponding to the opened file
+    path: input
+      Full path and name to the Y4M file to open
+    Returns if the program could open the video file
+*/
+bool openY4M(Ptr< FrameSource >& source, const char* path)
+{
+  source = new Y4MSource(path);
+  return source->isOpened();
+}
+
+
+
+/*
+  openReplay
+  Function attempting to open a frame file saved with --record, whose frames are mapped in memory and replayed as captured
+    source: output
+      Frame source corresponding to the opened file
+    path: input
+      Full path and name to the frame file to open
+    realtime: input
+      Whether to replay the frames at their capture pace, as a live camera, instead of as fast as possible
+    Returns if the program could open the frame file
+*/
+bool openReplay(Ptr< FrameSource >& source, const char* path, bool realtime)
+{
+  source = new ReplaySource(path, realtime);
+  return source->isOpened();
+}
+
+
+
+/*
+  loadCamera
+  Function loading the reprojection data of a camera and opening its video source
     projname: input
       Full path and name to the YML file from which to get reprojection data
       About required YML structure, refer to example file
-    scnname: input
-      Full path and name to the YML file from which to get scene reference data
-      About required YML structure, refer to example file
     source: input
-      String indicating which source will be used : AVI file or camera
-      source should be a full path to an AVI file
+      String indicating which source will be used : AVI file, Y4M file, frame file or camera
+      source should be a full path to an AVI, Y4M or QRF file
       or an integer corresponding to the index of the first camera to try to connect to
+    luma: input
+      Whether the video source should deliver the luma plane only
+    realtime: input
+      Whether a frame file should be replayed at its capture pace rather than as fast as possible
     M: output
       Loaded transformation matrix
-    scnsize: output
-      Loaded dimensions of the scene
-    videocap: output
-      VideoCapture object corresponding to the loaded video source
+    frames: output
+      Frame source corresponding to the loaded video source
+    live: output
+      Whether the source is a live camera, whose frames may be dropped, or a file to be read entirely
     Returns if the data loading was successful
 */
-bool loadData(const char* projname, const char* scnname, char* source, Mat& M, Size& scnsize, VideoCapture& videocap)
+bool loadCamera(const char* projname, const char* source, bool luma, bool realtime, Mat& M, Ptr< FrameSource >& frames, bool& live)
 {
-  // Load transformation matrix and scene data from reference files
+  // Load transformation matrix from reference file
   bool proj_loaded = readProj(projname, M);
   cout << ( proj_loaded ? "Reprojection data successfully loaded from: " : "Failed to load reprojection data from: ") << projname << endl;
 
-  bool scn_loaded = readScene(scnname, scnsize);
-  cout << ( scn_loaded ? "Scene data successfully loaded from: " : "Failed to load scene data from: ") << scnname << endl;
-
   // Open the video source
   bool cap_opened = false;
   string src(source);
+  string ext = src.substr(src.find_last_of(".") + 1);
+
+  live = ( (ext != "avi") && (ext != "y4m") && (ext != "qrf") ) || ( (ext == "qrf") && realtime );
 
-  if(src.substr(src.find_last_of(".") + 1) == "avi") {
+  if(ext == "avi") {
     cout << "Source detected: AVI video file." << endl;
-    cap_opened = openAVI(videocap, source);
+    cap_opened = openAVI(frames, source, luma);
+    cout << ( cap_opened ? "Video successfully opened at: " : "Failed to open video file at: ") << src << endl;
+  }
+  else if(ext == "y4m") {
+    cout << "Source detected: Y4M video file, reading its luma plane only." << endl;
+    cap_opened = openY4M(frames, source);
     cout << ( cap_opened ? "Video successfully opened at: " : "Failed to open video file at: ") << src << endl;
   }
+  else if(ext == "qrf") {
+    cout << "Source detected: frame file, replayed " << (realtime ? "at its capture pace." : "as fast as possible.") << endl;
+    cap_opened = openReplay(frames, source, realtime);
+    cout << ( cap_opened ? "Frames successfully mapped from: " : "Failed to open frame file at: ") << src << endl;
+  }
   else {
     cout << "Source detected: camera." << endl;
     int camindex = atoi(source);
@@ -198,11 +263,51 @@ bool loadData(const char* projname, const char* scnname, char* source, Mat& M, S
       cerr << "Camera index given is invalid: " << source << ". Positive integer expected." << endl;
       exit(EXIT_FAILURE);
     }
-    cap_opened = openCam(videocap, camindex);
+    cap_opened = openCam(frames, camindex, luma);
     cout << ( cap_opened ? "Camera connection successfully opened at index " : "Failed to connect to camera! Final index: ") << camindex << endl;
   }
 
-  return (cap_opened && proj_loaded && scn_loaded);
+  return (cap_opened && proj_loaded);
+}
+
+
+
+/*
+  loadData
+  Function loading and checking all required data
+    projname: input
+      Full path and name to the YML file from which to get reprojection data
+      About required YML structure, refer to example file
+    scnname: input
+      Full path and name to the YML file from which to get scene reference data
+      About required YML structure, refer to example file
+    source: input
+      String indicating which source will be used : AVI file, Y4M file, frame file or camera
+      source should be a full path to an AVI, Y4M or QRF file
+      or an integer corresponding to the index of the first camera to try to connect to
+    luma: input
+      Whether the video source should deliver the luma plane only
+    realtime: input
+      Whether a frame file should be replayed at its capture pace rather than as fast as possible
+    M: output
+      Loaded transformation matrix
+    scnsize: output
+      Loaded dimensions of the scene
+    frames: output
+      Frame source corresponding to the loaded video source
+    live: output
+      Whether the source is a live camera, whose frames may be dropped, or a file to be read entirely
+    Returns if the data loading was successful
+*/
+bool loadData(const char* projname, const char* scnname, char* source, bool luma, bool realtime, Mat& M, Size& scnsize, Ptr< FrameSource >& frames, bool& live)
+{
+  bool cam_loaded = loadCamera(projname, source, luma, realtime, M, frames, live);
+
+  // Load scene data from reference file
+  bool scn_loaded = readScene(scnname, scnsize);
+  cout << ( scn_loaded ? "Scene data successfully loaded from: " : "Failed to load scene data from: ") << scnname << endl;
+
+  return (cam_loaded && scn_loaded);
 }
 
 
@@ -219,6 +324,26 @@ void interrupt_loop(int sig) // Whenever the user exits with Ctrl-C
 
 
 
+/*
+  reportLatency
+  Function writing the latency of each stage of the scan loop in the console, and into a file if requested
+    stats: input
+      Latency histograms gathered by the loop
+    opts: input
+      Options of the run, the report is also saved into opts.latencyfile unless it is empty
+*/
+void reportLatency(const LatencyStats& stats, const trackOptions& opts)
+{
+  stats.print(cout);
+
+  if (! opts.latencyfile.empty() ) {
+    bool saved = stats.save(opts.latencyfile);
+    cout << (saved ? "Latency report successfully saved at: " : "Failed to save latency report at: ") << opts.latencyfile << endl;
+  }
+}
+
+
+
 /*
   scan
   Function scanning an image taken from a calibrated camera to identify QR or bar codes
@@ -226,96 +351,149 @@ void interrupt_loop(int sig) // Whenever the user exits with Ctrl-C
       Transformation matrix to reproject the images from the video stream
     scnsize: input
       Dimensions of the scene, bounding the reprojected images
-    videocap: input
-      VideoCapture object corresponding to the video source
+    source: input
+      Opened video source, delivering BGR frames or their luma plane
+    live: input
+      Whether the source is a live camera, in which case only the latest frame is processed
+    anchors: input
+      Anchor tags declared in the scene, watched for calibration drift
+    opts: input
+      Options of the run
+      With opts.corners, the camera frame is scanned as is and only the symbols' corners are reprojected
+      With opts.remap, the grayscale camera frame is reprojected through precomputed tables
+      With opts.roi, most frames are scanned only around the symbols found previously
+      With opts.tiles, the image is scanned as overlapping tiles on a pool of threads
+      With opts.pyramid, a downscaled image is scanned and the symbols are refined at full resolution
+      With opts.budget, the processing is degraded step by step while frames take longer than the budget, and restored with headroom
+      With opts.recordfile, every frame read from the source is saved raw by the capture thread, to be replayed bit-exact
+      With opts.drift, the anchors are checked every opts.driftperiod seconds and the transformation corrected in the background
+      Unless opts.headless, the found symbols are shown at most opts.previewrate times per second by a visualization thread
+      The latency of each stage is written in the console when the loop ends, and into opts.latencyfile if given
 */
-int scan(Mat M, Size scnsize, VideoCapture& videocap)
+int scan(Mat M, Size scnsize, FrameSource& source, bool live, const vector< anchorTag >& anchors, const trackOptions& opts)
 {
-  Mat frame, gray; // Images that will be read and scanned
-  bool frame_OK = false;
-
-  int width = scnsize.width, height = scnsize.height; // Dimensions of the scene
-
-  ImageScanner scanner; // Code scanner
-  scanner.set_config(ZBAR_QRCODE, ZBAR_CFG_ENABLE, 1);
+  Mat frame; // Image that will be read
+  FrameGrabber grabber(source, !live); // Capture thread feeding the loop with the latest frame
+  Pipeline pipeline(M, scnsize, opts); // Reprojection, scanning and pose computation
+  vector< qrSymbol > symbols; // Symbols found in the current frame
+  vector< int > IDs; // Metabot number of each symbol, -1 for the other symbols
+  chrono::steady_clock::time_point stamp; // Capture time of the current frame
+  LatencyStats stats; // Latency histograms of the loop stages
+  StageClock clk(stats);
+  LoadShedder shedder(opts.budget); // Degradation level keeping the latency of a frame within the budget
+  DriftMonitor drift(anchors, M, scnsize, opts); // Calibration checked against the anchor tags, corrected in the background
+  Mat driftM; // Corrected transformation and its tables, swapped in between two frames
+  Ptr< WarpMap > driftWarpmap;
+  Ptr< GrayWarp > driftGraywarp;
+  int status = EXIT_SUCCESS;
+
+  //* # DATA # Symbols' data, written in the console or into opts.logfile by a background thread
+  PoseLog logger(opts.logfile, opts.trajectoryfile);
+  if (! logger.start() )
+    for(size_t f = 0; f < logger.getFailed().size(); f++)
+      cerr << "Failed to create: " << logger.getFailed()[f] << ", logging without it" << endl;
+  // # DATA # */
 
   /* # SHOW # Display current frame in a window
   namedWindow("Reprojected frame", 1);
   // # SHOW # */
 
-  //* # HIGHLIGHT # Delimit detected symbols in the reprojected image
-  Scalar color(0, 0, 255); // BGR pure red to highlight detected symbols
-  namedWindow("Found symbols", 1);
+  //* # HIGHLIGHT # Delimit detected symbols in the scanned image, from a visualization thread
+  Preview preview("Found symbols", opts.previewrate);
+  if (! opts.headless)
+    preview.start();
   // # HIGHLIGHT # */
 
+  FrameRecorder recorder(opts.recordfile); // Raw frames saved by the capture thread, for bit-exact replays
+  if (! opts.recordfile.empty() ) {
+    if ( recorder.start() )
+      grabber.record(&recorder);
+    else
+      cerr << "Failed to open frame file at: " << opts.recordfile << endl;
+  }
+
+  if (opts.drift > 0)
+    drift.start();
+
   // Main loop going through the video stream
   signal(SIGINT, interrupt_loop); // Register interruption signal
+  grabber.start();
+
+  if ( (opts.warpbench > 0) && grabber.retrieve(frame) ) { // Measure the reprojection cost on the first frame
+    if (frame.channels() == 3)
+      benchWarp(frame, M, scnsize, WarpMap(M, scnsize, opts.stripes), opts.warpbench);
+    else
+      cout << "The source delivers luma frames, there is no color conversion to compare: skipping the reprojection benchmark" << endl;
+  }
 
   while(! loop_exit) {
-    frame_OK = videocap.read(frame);
-    waitKey(1); // Allows the buffer to refresh
-    if (! (frame.data && frame_OK)) {
+    clk.start();
+    if (! grabber.retrieve(frame, stamp) ) {
       cerr << "Failed to load image from source!" << endl;
-      exit(EXIT_FAILURE);
+      status = EXIT_FAILURE;
+      break;
     }
+    clk.lap(STAGE_CAPTURE);
 
-    warpPerspective(frame, frame, M, scnsize); // Apply this transformation on the whole image
-    cvtColor(frame, gray, CV_BGR2GRAY); // Get grayscale image for scanning phase
+    if ( shedder.skip() ) // Dropped unprocessed, so that the next frames catch up with the camera
+      continue;
+    if ( drift.retrieve(driftM, driftWarpmap, driftGraywarp) ) // Tables already computed by the monitor, the switch is immediate
+      pipeline.retarget(driftM, driftWarpmap, driftGraywarp);
+    pipeline.shed(shedder.getLevel());
+    pipeline.process(frame, symbols, clk);
+    drift.observe(symbols);
 
     /* # SHOW #
-    imshow("Reprojected frame", frame);
+    imshow("Reprojected frame", pipeline.view());
+    waitKey(1); // Allows the HighGUI events to be processed
     // # SHOW # */
-    
-    // Convert image from cv::Mat to zbar::Image
-    uchar *raw = (uchar*) gray.data; // Raw image data
-    Image image(width, height, "Y800", raw, width * height);
-    // Using another syntax to call the same constructor seems to cause a systematic crash...
-    
-    // Scan for codes in the image
-    int nsyms = scanner.scan(image);
 
-    // Extract results
-
-    //* # DATA # Write symbols' data in the console
-    cout << nsyms << " symbol(s) found in the given image" << endl;
+    //* # DATA # Log symbols' data, the loop never waits for the console or the disk
+    logger.beginFrame(stamp, symbolIDs(symbols, IDs)); // Only the Metabots are logged
     // # DATA # */
 
-    for(Image::SymbolIterator symbol = image.symbol_begin(); symbol != image.symbol_end(); ++symbol) {
-      char ID = symbol->get_data()[0];
-      
-      int n = symbol->get_location_size();
-      Point2f center, pNorth;
-      for(int i = 0; i < n; i++) {
-        Point2f p = Point2f(symbol->get_location_x(i),symbol->get_location_y(i));
-        center += p;
-        if ((i == 0) || (i == 3))
-          pNorth += p;
-
-        //* # HIGHLIGHT #
-        circle(frame, p, 6, color, 2);
-        // # HIGHLIGHT # */
-      }
-
-      center = 0.25 * center; // Center of the QRcode
-      pNorth = 0.5 * pNorth; // Middle of the north west and north east points of the QR code
-      float angle = atan2(pNorth.y - center.y, pNorth.x - center.x) * 180. / PI; // Angle of the QR code
+    for(size_t s = 0; s < symbols.size(); s++) {
+      const qrSymbol& symbol = symbols[s];
 
-      //* # HIGHLIGHT #
-      arrowedLine(frame, center, pNorth, color, 2);
-      // # HIGHLIGHT # */
-      
       //* # DATA #
-      cout << "Data: \"" << ID << "\" - Angle: " << angle << " - Center: " << center << endl;
-      //publishTree(ID, center, angle);
+      if (IDs[s] >= 0) {
+        logger.record(IDs[s], symbol.center, symbol.angle);
+        //publishTree(IDs[s], symbol.center, symbol.angle);
+      }
       // # DATA # */
     }
+    clk.lap(STAGE_PUBLISH);
 
     //* # HIGHLIGHT #
-    imshow("Found symbols", frame);
+    if ( !opts.headless && (shedder.getLevel() < SHED_HIGHLIGHT) )
+      preview.offer(pipeline.getGray(), symbols); // Copied only a few times per second, drawn and shown by the visualization thread
     // # HIGHLIGHT # */
+    clk.lap(STAGE_SHOW);
+
+    int level = shedder.getLevel();
+    if (shedder.update(stamp) != level)
+      cerr << "Load shedding level: " << LoadShedder::levelName(shedder.getLevel()) << endl;
+
+    clk.end();
   }
-  
-  return EXIT_SUCCESS;
+
+  grabber.stop();
+  recorder.stop();
+  drift.stop();
+  //* # DATA #
+  logger.stop();
+  cout << "Log records written: " << logger.getWritten() << " - dropped: " << logger.getDropped() << endl;
+  // # DATA # */
+  cout << "Frames captured: " << grabber.getCaptured() << " - processed: " << grabber.getProcessed() << " - dropped: " << grabber.getDropped() << endl;
+  if (! opts.recordfile.empty() )
+    cout << "Frames recorded: " << recorder.getRecorded() << " - dropped: " << recorder.getDropped() << " - bytes written: " << recorder.getBytes() << endl;
+  if (opts.budget > 0)
+    shedder.print(cout);
+  if (opts.drift > 0)
+    cout << "Drift checks: " << drift.getChecks() << " - corrections: " << drift.getCorrections() << " - last drift: " << drift.getDrift() << endl;
+  reportLatency(stats, opts);
+
+  return status;
 }
 
 
@@ -328,7 +506,7 @@ int scan(Mat M, Size scnsize, VideoCapture& videocap)
   dIndex: input
     Index of the GPU device to enable
 */
-int scanGPU(Mat M, Size scnsize, VideoCapture& videocap, const int dIndex)
+int scanGPU(Mat M, Size scnsize, FrameSource& source, bool live, const trackOptions& opts, const int dIndex)
 {
   // Set detected GPU as used device
   gpu::setDevice(dIndex);
@@ -336,73 +514,223 @@ int scanGPU(Mat M, Size scnsize, VideoCapture& videocap, const int dIndex)
   // Images that will be read and scanned
   Mat frame, gray;
   gpu::GpuMat gframe, ggray;
-  bool frame_OK = false;
-
-  int width = scnsize.width, height = scnsize.height; // Dimensions of the scene
+  FrameGrabber grabber(source, !live); // Capture thread feeding the loop with the latest frame
+  vector< qrSymbol > symbols; // Symbols found in the current frame
+  vector< int > IDs; // Metabot number of each symbol, -1 for the other symbols
+  chrono::steady_clock::time_point stamp; // Capture time of the current frame
+  RoiTracker tracker(opts.roimargin, opts.sweep); // Search windows around the symbols already found
+  LatencyStats stats; // Latency histograms of the loop stages
+  StageClock clk(stats);
+  int status = EXIT_SUCCESS;
+
+  Ptr< TileScanner > tiler; // Pool of scanners working on overlapping tiles
+  if (opts.tiles)
+    tiler = new TileScanner(opts.footprint, opts.threads);
+
+  Ptr< PyramidScanner > pyramid; // Coarse level scanning with full resolution refinement
+  if (opts.pyramid)
+    pyramid = new PyramidScanner(opts.pyramid, opts.roimargin);
 
   ImageScanner scanner; // Code scanner
   scanner.set_config(ZBAR_NONE, ZBAR_CFG_ENABLE, 1);
 
+  //* # DATA # Symbols' data, written in the console or into opts.logfile by a background thread
+  PoseLog logger(opts.logfile, opts.trajectoryfile);
+  if (! logger.start() )
+    for(size_t f = 0; f < logger.getFailed().size(); f++)
+      cerr << "Failed to create: " << logger.getFailed()[f] << ", logging without it" << endl;
+  // # DATA # */
+
   /* # SHOW # Display current frame in a window
   namedWindow("Reprojected frame", 1);
   // # SHOW # */
 
+  FrameRecorder recorder(opts.recordfile); // Raw frames saved by the capture thread, for bit-exact replays
+  if (! opts.recordfile.empty() ) {
+    if ( recorder.start() )
+      grabber.record(&recorder);
+    else
+      cerr << "Failed to open frame file at: " << opts.recordfile << endl;
+  }
+
   // Main loop going through the video stream
   signal(SIGINT, interrupt_loop); // Register interruption signal
+  grabber.start();
 
   while(! loop_exit) {
-    frame_OK = videocap.read(frame);
-    waitKey(1); // Allows the buffer to refresh
-    if (! (frame.data && frame_OK)) {
+    clk.start();
+    if (! grabber.retrieve(frame, stamp) ) {
       cerr << "Failed to load image from source!" << endl;
-      exit(EXIT_FAILURE);
+      status = EXIT_FAILURE;
+      break;
     }
+    clk.lap(STAGE_CAPTURE);
 
     gframe.upload(frame);
-    gpu::warpPerspective(gframe, gframe, M, scnsize); // Apply this transformation on the whole image
-    gpu::cvtColor(gframe, ggray, CV_BGR2GRAY); // Get grayscale image for scanning phase
-    ggray.download(gray);
+    if (! opts.corners)
+      gpu::warpPerspective(gframe, gframe, M, scnsize); // Apply this transformation on the whole image
+    clk.lap(STAGE_WARP);
+    if (gframe.channels() == 1) // The source delivered the luma plane only
+      gframe.download(gray);
+    else {
+      gpu::cvtColor(gframe, ggray, CV_BGR2GRAY); // Get grayscale image for scanning phase
+      ggray.download(gray);
+    }
+    clk.lap(STAGE_GRAY);
 
     /* # SHOW #
     imshow("Reprojected frame", frame);
+    waitKey(1); // Allows the HighGUI events to be processed
     // # SHOW # */
     
-    uchar *raw = (uchar*) gray.data; // Raw image data
-    Image image(width, height, "Y800", raw, width * height);
-    
-    // Scan for codes in the image
-    int nsyms = scanner.scan(image);
+    // Scan for codes in the image, only within the tracked windows on most frames, or tile by tile in parallel when enabled
+    if (opts.roi)
+      tracker.scan(scanner, gray, symbols);
+    else if (opts.tiles)
+      tiler->scan(gray, symbols);
+    else if (opts.pyramid)
+      pyramid->scan(scanner, gray, symbols);
+    else
+      scanSymbols(scanner, gray, symbols);
+    clk.lap(STAGE_SCAN);
 
     // Extract results
+    if (opts.corners) {
+      projectSymbols(symbols, M); // Map the location points into the scene plane
+      clk.lap(STAGE_WARP);
+    }
 
-    //* # DATA # Write symbols' data in the console
-    cout << nsyms << " symbol(s) found in the given image" << endl;
-    // # DATA # */
+    for(size_t s = 0; s < symbols.size(); s++)
+      computePose(symbols[s]);
+    clk.lap(STAGE_POSE);
 
-    for(Image::SymbolIterator symbol = image.symbol_begin(); symbol != image.symbol_end(); ++symbol) {
-      char ID = symbol->get_data()[0];
+    //* # DATA # Log symbols' data, the loop never waits for the console or the disk
+    logger.beginFrame(stamp, symbolIDs(symbols, IDs)); // Only the Metabots are logged
+    // # DATA # */
 
-      int n = symbol->get_location_size();
-      Point2f center, pNorth;
-      for(int i = 0; i < n; i++) {
-        Point2f p = Point2f(symbol->get_location_x(i),symbol->get_location_y(i));
-        center += p;
-        if (i < 2)
-          pNorth += p;
+    for(size_t s = 0; s < symbols.size(); s++) {
+      const qrSymbol& symbol = symbols[s];
+      
+      //* # DATA #
+      if (IDs[s] >= 0) {
+        logger.record(IDs[s], symbol.center, symbol.angle);
+        //publishTree(IDs[s], symbol.center, symbol.angle);
       }
+      // # DATA # */
+    }
+    clk.lap(STAGE_PUBLISH);
+
+    clk.end();
+  }
+
+  grabber.stop();
+  recorder.stop();
+  //* # DATA #
+  logger.stop();
+  cout << "Log records written: " << logger.getWritten() << " - dropped: " << logger.getDropped() << endl;
+  // # DATA # */
+  cout << "Frames captured: " << grabber.getCaptured() << " - processed: " << grabber.getProcessed() << " - dropped: " << grabber.getDropped() << endl;
+  if (! opts.recordfile.empty() )
+    cout << "Frames recorded: " << recorder.getRecorded() << " - dropped: " << recorder.getDropped() << " - bytes written: " << recorder.getBytes() << endl;
+  reportLatency(stats, opts);
+
+  return status;
+}
+
+
+
+/*
+  scanMulti
+  Function tracking symbols with several calibrated cameras looking at the same scene
+  Each camera is read, reprojected and scanned on its own threads, symbols with the same data are fused into one pose
+    Ms: input
+      Transformation matrices reprojecting the images of each camera into the scene
+    scnsize: input
+      Dimensions of the scene shared by every camera
+    sources: input
+      Opened video source of each camera
+    lives: input
+      Whether each source is a live camera, in which case only its latest frame is processed
+    opts: input
+      Options of the run, applied to every camera
+*/
+int scanMulti(const vector< Mat >& Ms, Size scnsize, vector< Ptr< FrameSource > >& sources, const vector< bool >& lives, const trackOptions& opts)
+{
+  LatencyStats stats; // Latency histograms of the loop stages, shared with the camera workers
+  StageClock clk(stats);
+  CameraFusion fusion(scnsize, opts, sources.size(), stats); // Camera workers and fusion of their symbols
+  vector< qrSymbol > symbols; // Symbols found in the current fused frame
+  vector< int > IDs; // Metabot number of each symbol, -1 for the other symbols
+  chrono::steady_clock::time_point stamp; // Mean capture time of the current fused frame
+  int status = EXIT_SUCCESS;
+
+  for (size_t c = 0; c < sources.size(); c++)
+    fusion.addCamera(Ms[c], *sources[c], lives[c]);
+  if (! opts.recordfile.empty() )
+    cerr << "Frames are only recorded with a single camera, ignoring: " << opts.recordfile << endl;
+
+  //* # DATA # Symbols' data, written in the console or into opts.logfile by a background thread
+  PoseLog logger(opts.logfile, opts.trajectoryfile);
+  if (! logger.start() )
+    for(size_t f = 0; f < logger.getFailed().size(); f++)
+      cerr << "Failed to create: " << logger.getFailed()[f] << ", logging without it" << endl;
+  // # DATA # */
+
+  //* # HIGHLIGHT # Delimit detected symbols in the scene plane, from a visualization thread
+  Mat canvas(scnsize.height, scnsize.width, CV_8UC1, Scalar(255)); // Blank scene to draw on
+  Preview preview("Found symbols", opts.previewrate, true); // Fused symbols are drawn by their corners on the scene
+  if (! opts.headless)
+    preview.start();
+  // # HIGHLIGHT # */
+
+  // Main loop going through the fused video streams
+  signal(SIGINT, interrupt_loop); // Register interruption signal
+  fusion.start();
+
+  while(! loop_exit) {
+    clk.start();
+    if (! fusion.retrieve(symbols, stamp) ) {
+      cerr << "Failed to load image from every source!" << endl;
+      status = EXIT_FAILURE;
+      break;
+    }
+    clk.lap(STAGE_FUSE);
+
+    //* # DATA # Log symbols' data, the loop never waits for the console or the disk
+    logger.beginFrame(stamp, symbolIDs(symbols, IDs)); // Only the Metabots are logged
+    // # DATA # */
+
+    for(size_t s = 0; s < symbols.size(); s++) {
+      const qrSymbol& symbol = symbols[s];
 
-      center = 0.25 * center; // Center of the QRcode
-      pNorth = 0.5 * pNorth; // Middle of the north west and north east points of the QR code
-      float angle = atan2(pNorth.y - center.y, pNorth.x - center.x) * 180. / PI; // Angle of the QR code
-      
       //* # DATA #
-      cout << "Data: \"" << ID << "\" - Angle: " << angle << " - Center: " << center << endl;
-      //publishTree(ID, center, angle);
+      if (IDs[s] >= 0) {
+        logger.record(IDs[s], symbol.center, symbol.angle);
+        //publishTree(IDs[s], symbol.center, symbol.angle);
+      }
       // # DATA # */
     }
+    clk.lap(STAGE_PUBLISH);
+
+    //* # HIGHLIGHT #
+    if (! opts.headless)
+      preview.offer(canvas, symbols); // Copied only a few times per second, drawn and shown by the visualization thread
+    // # HIGHLIGHT # */
+    clk.lap(STAGE_SHOW);
+
+    clk.end();
   }
 
-  return EXIT_SUCCESS;
+  fusion.stop();
+  //* # DATA #
+  logger.stop();
+  cout << "Log records written: " << logger.getWritten() << " - dropped: " << logger.getDropped() << endl;
+  // # DATA # */
+  for (int c = 0; c < fusion.getCameras(); c++)
+    cout << "Camera " << c << ": frames captured: " << fusion.getCaptured(c) << " - processed: " << fusion.getProcessed(c) << " - dropped: " << fusion.getDropped(c) << " - results not fused: " << fusion.getSkipped(c) << endl;
+  reportLatency(stats, opts);
+
+  return status;
 }
 
 
@@ -413,22 +741,47 @@ int scanGPU(Mat M, Size scnsize, VideoCapture& videocap, const int dIndex)
 
 int main(int args, char* argv[])
 {
-  if (args != param + 1) {
+  trackOptions opts; // Optional parameters following the mandatory ones
+
+  if ( (args < param + 1) || !readOptions(args, argv, param + 1, opts) ) {
     if (args < param + 1)
       cout << "Too few arguments!";
     else
-      cout << "Too many arguments!";
-    cerr << " Number given: " << args - 1 << endl << "Usage: qr-track <calib-data.yml> <scn-data.yml> <video-source>" << endl;
+      cout << "Invalid options!";
+    cerr << " Number given: " << args - 1 << endl << "Usage: qr-track <calib-data.yml> <scn-data.yml> <video-source> [options]" << endl << optionsUsage();
     exit(EXIT_FAILURE);
   }
 
   else {
     cout << bound << endl << "QR tracker based on reprojection data" << endl << endl;
-    Mat M;
     Size scnsize;
-    VideoCapture videocap;
+    vector< Ptr< FrameSource > > sources(1 + opts.cameras.size()); // Video source of each camera, the first one given by the mandatory arguments
+    vector< Mat > Ms(sources.size()); // Transformation matrix of each camera
+    vector< bool > lives(sources.size(), true);
+    bool live = true;
+    vector< anchorTag > anchors; // Tags fixed in the scene, against which the calibration is checked
+
+    bool loaded = loadData(argv[1], argv[2], argv[3], opts.luma, opts.realtime, Ms[0], scnsize, sources[0], live);
+    lives[0] = live;
+    for (size_t c = 0; c < opts.cameras.size(); c++) { // Additional cameras sharing the same scene
+      loaded = loadCamera(opts.cameras[c].first.c_str(), opts.cameras[c].second.c_str(), opts.luma, opts.realtime, Ms[c + 1], sources[c + 1], live) && loaded;
+      lives[c + 1] = live;
+    }
+
+    if ( loaded && (opts.drift > 0) ) {
+      if (! readAnchors(argv[2], anchors) ) {
+        cerr << "Invalid anchor tags in: " << argv[2] << endl;
+        loaded = false;
+      }
+      else if ( anchors.empty() )
+        cout << "No anchor tag declared in the scene: the calibration will not be checked" << endl;
+      else if ( sources.size() > 1 )
+        cout << "Several cameras: the calibration will not be checked" << endl;
+      else
+        cout << anchors.size() << " anchor tags declared in the scene" << endl;
+    }
 
-    if ( loadData(argv[1], argv[2], argv[3], M, scnsize, videocap) ) {
+    if ( loaded ) {
       bool useCPU = true;
       int dIndex = 0;
 
@@ -449,10 +802,12 @@ int main(int args, char* argv[])
       else
         cout << "\"tryGPU\" option disabled. Processing with CPU..." << endl << bound << endl << endl;
 
-      if( useCPU )
-        return scan(M, scnsize, videocap);
+      if( sources.size() > 1 )
+        return scanMulti(Ms, scnsize, sources, lives, opts);
+      else if( useCPU )
+        return scan(Ms[0], scnsize, *sources[0], lives[0], anchors, opts);
       else
-        return scanGPU(M, scnsize, videocap, dIndex);
+        return scanGPU(Ms[0], scnsize, *sources[0], lives[0], opts, dIndex);
     }
     else {
       cerr << endl << bound << endl << "Aborting scanning..." << endl;
@@ -0,0 +1,119 @@
+#include <iostream> // Console outputs
+#include <vector>
+#include <string>
+#include <chrono>
+#include <climits>
+#include <stdlib.h>
+using namespace std;
+
+#include "trajectory.hpp"
+
+#include "qr-traj.hpp"
+
+
+
+/*
+  printInfo
+  Function writing the summary of a trajectory file: span, blocks, frames, poses and size
+    reader: input
+      Reader opened on the file
+    out: input output
+      Stream to write into
+*/
+void printInfo(const TrajectoryReader& reader, ostream& out)
+{
+  const vector< trajBlock >& blocks = reader.getBlocks();
+  unsigned long frames = 0, poses = 0;
+  for (size_t b = 0; b < blocks.size(); b++) {
+    frames += blocks[b].frames;
+    poses += blocks[b].poses;
+  }
+  double span = blocks.empty() ? 0 : (blocks.back().last - blocks.front().first) / 1e6;
+
+  out << "Opened at " << reader.getHeader().start << " us since the epoch" << endl
+      << "Span: " << span << " s - blocks: " << blocks.size() << " - frames: " << frames << " - poses: " << poses << endl
+      << "Size: " << reader.getBytes() << " bytes";
+  if (poses > 0)
+    out << " - " << (double) reader.getBytes() / poses << " bytes per pose";
+  out << endl
+      << "Quanta: " << reader.getHeader().posQuantum << " scene units, " << reader.getHeader().angleQuantum << " degrees" << endl;
+}
+
+
+
+/*
+  printPoses
+  Function writing poses as CSV rows, with a header row
+    poses: input
+      Poses to write, their time is given in seconds since the file was opened
+    out: input output
+      Stream to write into
+*/
+void printPoses(const vector< trajPose >& poses, ostream& out)
+{
+  out << "time_s,id,x,y,angle" << '\n';
+  for (size_t i = 0; i < poses.size(); i++)
+    out << poses[i].stamp / 1e6 << ',' << poses[i].ID << ',' << poses[i].x << ',' << poses[i].y << ',' << poses[i].angle << '\n';
+  out.flush();
+}
+
+
+
+int main(int args, char* argv[])
+{
+  // Time span in seconds and ID range of the query, everything by default
+  double from = 0, to = -1, at = -1;
+  int minID = INT_MIN, maxID = INT_MAX;
+  bool info = false, args_OK = (args >= 2);
+
+  for (int i = 2; (i < args) && args_OK; i++) {
+    string opt(argv[i]);
+    if (opt == "--info")
+      info = true;
+    else if ( (opt == "--from") && (i + 1 < args) )
+      from = atof(argv[++i]);
+    else if ( (opt == "--to") && (i + 1 < args) )
+      to = atof(argv[++i]);
+    else if ( (opt == "--at") && (i + 1 < args) )
+      at = atof(argv[++i]);
+    else if ( (opt == "--ids") && (i + 2 < args) ) {
+      minID = atoi(argv[++i]);
+      maxID = atoi(argv[++i]);
+    }
+    else
+      args_OK = false;
+  }
+
+  if (!args_OK) {
+    cerr << "Usage: qr-traj <trajectory> [--info] [--at <s>] [--from <s>] [--to <s>] [--ids <first> <last>]" << endl
+         << "  Writes as CSV the poses of a trajectory saved by qr-track or qr-scan with --trajectory" << endl
+         << "  --info           Summary of the file instead of the poses" << endl
+         << "  --at <s>         Poses of the last frame captured at or before <s> seconds" << endl
+         << "  --from, --to <s> Time span in seconds since the file was opened, default: the whole file" << endl
+         << "  --ids <first> <last>  Range of Metabot IDs, default: all of them" << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+  TrajectoryReader reader;
+  if (! reader.open(argv[1]) ) {
+    cerr << "Failed to read trajectory from: " << argv[1] << endl;
+    exit(EXIT_FAILURE);
+  }
+  chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+
+  vector< trajPose > poses;
+  if (info)
+    printInfo(reader, cout);
+  else if (at >= 0)
+    reader.frameAt((int64_t) (at * 1e6), poses);
+  else
+    reader.read((int64_t) (from * 1e6), (to < 0) ? INT64_MAX : (int64_t) (to * 1e6), minID, maxID, poses);
+  chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+
+  if (!info)
+    printPoses(poses, cout);
+  cerr << "Indexed in " << chrono::duration< double, milli >(t1 - t0).count() << " ms, queried in " << chrono::duration< double, milli >(t2 - t1).count() << " ms" << endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,25 @@
+using namespace std;
+
+
+
+/*
+  printInfo
+  Function writing the summary of a trajectory file: span, blocks, frames, poses and size
+    reader: input
+      Reader opened on the file
+    out: input output
+      Stream to write into
+*/
+void printInfo(const TrajectoryReader& reader, ostream& out);
+
+
+
+/*
+  printPoses
+  Function writing poses as CSV rows, with a header row
+    poses: input
+      Poses to write, their time is given in seconds since the file was opened
+    out: input output
+      Stream to write into
+*/
+void printPoses(const vector< trajPose >& poses, ostream& out);
@@ -0,0 +1,139 @@
+#include <algorithm>
+
+#include "roitracker.hpp"
+
+
+
+RoiTracker::RoiTracker(int margin, int sweep) :
+  _margin(margin),
+  _sweep(sweep > 0 ? sweep : 1),
+  _count(0),
+  _lost(false),
+  _swept(false),
+  _scanned(0)
+{
+}
+
+
+
+int RoiTracker::scan(ImageScanner& scanner, const Mat& gray, vector< qrSymbol >& symbols, PyramidScanner* sweeper, PyramidScanner* coarse)
+{
+  bool sweep = _lost || _tracks.empty() || (_count >= _sweep - 1);
+
+  if (sweep) {
+    if (sweeper) {
+      sweeper->scan(scanner, gray, symbols);
+      _scanned = sweeper->getScanned();
+    }
+    else {
+      scanSymbols(scanner, gray, symbols);
+      _scanned = gray.total();
+    }
+    _count = 0;
+  }
+  else {
+    symbols.clear();
+    _count++;
+
+    // Gather the windows within the image, merging the overlapping ones so that no area is scanned twice
+    Rect bounds(0, 0, gray.cols, gray.rows);
+    _windows.clear();
+    for (map< string, roiTrack >::iterator t = _tracks.begin(); t != _tracks.end(); ++t) {
+      Rect window = t->second.window & bounds;
+      if (window.area() > 0)
+        _windows.push_back(window);
+    }
+
+    bool merged = true;
+    while (merged) {
+      merged = false;
+      for (size_t i = 0; (i < _windows.size()) && !merged; i++)
+        for (size_t j = i + 1; (j < _windows.size()) && !merged; j++)
+          if ( (_windows[i] & _windows[j]).area() > 0 ) {
+            _windows[i] |= _windows[j];
+            _windows.erase(_windows.begin() + j);
+            merged = true;
+          }
+    }
+
+    // Scan each window on its own, coordinates are brought back into the whole image
+    _scanned = 0;
+    for (size_t w = 0; w < _windows.size(); w++) {
+      if (coarse) {
+        coarse->scanWindow(scanner, gray, _windows[w], _found);
+        _scanned += coarse->getScanned();
+      }
+      else {
+        gray(_windows[w]).copyTo(_buffer);
+        scanSymbols(scanner, _buffer, _found, Point2f(_windows[w].x, _windows[w].y));
+        _scanned += _buffer.total();
+      }
+      symbols.insert(symbols.end(), _found.begin(), _found.end());
+    }
+  }
+
+  update(symbols, sweep);
+  _swept = sweep;
+  return symbols.size();
+}
+
+
+
+void RoiTracker::update(const vector< qrSymbol >& symbols, bool swept)
+{
+  // Forget what the sweep did not find, mark what the windows missed
+  _lost = false;
+  for (map< string, roiTrack >::iterator t = _tracks.begin(); t != _tracks.end(); ) {
+    bool found = false;
+    for (size_t s = 0; (s < symbols.size()) && !found; s++)
+      found = (symbols[s].data == t->first);
+
+    if (found)
+      ++t;
+    else if (swept)
+      _tracks.erase(t++);
+    else {
+      _lost = true; // The next frame will be swept to find it again
+      ++t;
+    }
+  }
+
+  // Move the windows around the new locations, start tracking the new symbols
+  for (size_t s = 0; s < symbols.size(); s++) {
+    const vector< Point2f >& loc = symbols[s].location;
+    if (loc.empty())
+      continue;
+
+    float xmin = loc[0].x, xmax = loc[0].x, ymin = loc[0].y, ymax = loc[0].y;
+    for (size_t i = 1; i < loc.size(); i++) {
+      xmin = min(xmin, loc[i].x);
+      xmax = max(xmax, loc[i].x);
+      ymin = min(ymin, loc[i].y);
+      ymax = max(ymax, loc[i].y);
+    }
+
+    _tracks[symbols[s].data].window = Rect(Point(cvFloor(xmin) - _margin, cvFloor(ymin) - _margin),
+                                           Point(cvFloor(xmax) + _margin + 1, cvFloor(ymax) + _margin + 1));
+  }
+}
+
+
+
+bool RoiTracker::lastSweep() const
+{
+  return _swept;
+}
+
+
+
+int RoiTracker::getTracked() const
+{
+  return _tracks.size();
+}
+
+
+
+long RoiTracker::getScanned() const
+{
+  return _scanned;
+}
@@ -0,0 +1,88 @@
+#ifndef ROITRACKER_H
+#define ROITRACKER_H
+
+#include <map>
+#include <vector>
+#include <string>
+
+#include "opencv2/core/core.hpp"
+
+#include <zbar.h>
+
+#include "symbols.hpp"
+#include "pyramidscanner.hpp"
+
+using namespace std;
+using namespace cv;
+using namespace zbar;
+
+
+
+/*
+  RoiTracker
+  Class restricting the scanning phase to search windows around the symbols already found
+  Each symbol, identified by its data, keeps a window bounding its last location, extended by a margin
+  covering the furthest a robot can move between two frames
+  The whole image is swept every few frames, when nothing is tracked, or when a tracked symbol was lost,
+  so that new symbols are detected and lost ones are either found again or forgotten
+*/
+class RoiTracker
+{
+public:
+  /*
+    margin: input
+      Distance in pixels of the scanned image a symbol may move between two frames
+    sweep: input
+      Period in frames of the full image sweeps
+  */
+  RoiTracker(int margin, int sweep);
+
+  /*
+    scan
+    Function scanning an image, in full or only within the search windows
+      scanner: input
+        ZBar scanner to use
+      gray: input
+        Continuous 8-bit grayscale image to scan
+      symbols: output
+        Symbols found, with coordinates in the whole image
+      sweeper: input
+        Scanner of the full sweeps, such as a coarser pyramid level to keep them cheap, NULL to sweep at full resolution
+      coarse: input
+        Scanner of the windows, such as a coarser pyramid level to keep them cheap, NULL to scan them at full resolution
+      Returns the number of symbols found
+  */
+  int scan(ImageScanner& scanner, const Mat& gray, vector< qrSymbol >& symbols, PyramidScanner* sweeper = NULL, PyramidScanner* coarse = NULL);
+
+  // Whether the last scan swept the whole image
+  bool lastSweep() const;
+
+  // Number of pixels handed to ZBar by the last scan
+  long getScanned() const;
+
+  // Number of symbols currently tracked
+  int getTracked() const;
+
+private:
+  // Search window of a tracked symbol
+  struct roiTrack {
+    Rect window;
+  };
+
+  // Function updating the windows from the symbols found by the last scan
+  void update(const vector< qrSymbol >& symbols, bool swept);
+
+  map< string, roiTrack > _tracks; // Tracked symbols, by data
+  int _margin;
+  int _sweep;
+  int _count;   // Frames scanned since the last sweep
+  bool _lost;   // A tracked symbol was not found in its window
+  bool _swept;  // The last scan was a full sweep
+  long _scanned;
+
+  Mat _buffer;  // Continuous copy of the window being scanned
+  vector< qrSymbol > _found; // Symbols found in the window being scanned
+  vector< Rect > _windows;   // Windows to scan in the current frame
+};
+
+#endif // ROITRACKER_H
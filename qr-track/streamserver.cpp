@@ -0,0 +1,290 @@
+#include <iostream> // Console outputs
+#include <algorithm>
+
+#include "streamserver.hpp"
+
+
+
+StreamServer::frameSlot::frameSlot(const Mat& M, Size scnsize, const trackOptions& opts, const Ptr< WarpMap >& warpmap, const Ptr< GrayWarp >& graywarp, LatencyStats& stats) :
+  pipeline(M, scnsize, opts, warpmap, graywarp),
+  clk(stats),
+  nsyms(0),
+  done(false)
+{
+}
+
+
+
+StreamServer::stream::stream(const Mat& M, Size scnsize, FrameSource& source, bool live, const string& name) :
+  M(M),
+  scnsize(scnsize),
+  name(name),
+  grabber(source, !live),
+  processed(0),
+  symbols(0)
+{
+}
+
+
+
+StreamServer::StreamServer(const trackOptions& opts, LatencyStats& stats) :
+  _opts(opts),
+  _stats(stats),
+  _running(false),
+  _feeding(0)
+{
+  // The pool is the only source of parallelism, a task must not spawn threads of its own
+  _opts.tiles = false;
+  _opts.stripes = 1;
+
+  // Consecutive frames go to different slots: no state may follow the frames of a stream in order
+  _opts.roi = false;
+  _opts.budget = 0;
+}
+
+
+
+StreamServer::~StreamServer()
+{
+  stop();
+}
+
+
+
+void StreamServer::addStream(const Mat& M, Size scnsize, FrameSource& source, bool live, const string& name)
+{
+  _streams.push_back(unique_ptr< stream >(new stream(M, scnsize, source, live, name)));
+}
+
+
+
+bool StreamServer::start()
+{
+  if (_running || _streams.empty())
+    return false;
+
+  _pool.reset(new WorkPool(_opts.threads));
+
+  // Enough frames in flight for every worker to be busy, two per stream at least so that capture and processing overlap
+  int depth = max(2, (_pool->getThreads() + (int) _streams.size() - 1) / (int) _streams.size() + 1);
+
+  // A slot sees one frame out of depth, its pyramid retries look that much further around the symbols it found last
+  trackOptions slotOpts = _opts;
+  slotOpts.roimargin *= depth;
+
+  _running = true;
+  _start = chrono::steady_clock::now();
+  for (size_t s = 0; s < _streams.size(); s++) {
+    stream* st = _streams[s].get();
+    Pipeline::prepareTables(st->M, st->scnsize, _opts, st->warpmap, st->graywarp); // Computed once, however many slots
+    for (int d = 0; d < depth; d++) {
+      st->slots.push_back(unique_ptr< frameSlot >(new frameSlot(st->M, st->scnsize, slotOpts, st->warpmap, st->graywarp, _stats)));
+      st->free.push_back(st->slots.back().get());
+    }
+
+    if (! (_opts.logfile.empty() && _opts.trajectoryfile.empty()) ) {
+      string suffix = "." + to_string(s);
+      st->log.reset(new PoseLog(_opts.logfile.empty() ? "" : _opts.logfile + suffix, _opts.trajectoryfile.empty() ? "" : _opts.trajectoryfile + suffix));
+      if (! st->log->start() )
+        for (size_t f = 0; f < st->log->getFailed().size(); f++)
+          cerr << "Stream " << s << ": failed to create: " << st->log->getFailed()[f] << ", logging without it" << endl;
+    }
+
+    if (st->grabber.start()) {
+      _feeding++;
+      st->feeder = thread(&StreamServer::feed, this, st);
+    }
+    else
+      cerr << "Stream " << s << ": failed to start capturing from: " << st->name << endl;
+  }
+
+  return _feeding > 0;
+}
+
+
+
+void StreamServer::stop()
+{
+  _running = false;
+
+  // Stopping the grabbers makes the feeders waiting for a frame give up
+  for (size_t s = 0; s < _streams.size(); s++) {
+    stream* st = _streams[s].get();
+    {
+      lock_guard< mutex > guard(st->lock); // A feeder checking _running is either waiting already or sees it cleared
+    }
+    st->slotCond.notify_all();
+    st->grabber.stop();
+    if (st->feeder.joinable())
+      st->feeder.join();
+  }
+
+  // The frames in flight are finished, their tasks may still queue others
+  for (size_t s = 0; s < _streams.size(); s++) {
+    stream* st = _streams[s].get();
+    unique_lock< mutex > guard(st->lock);
+    st->slotCond.wait(guard, [st]{ return st->inflight.empty(); });
+  }
+  if (_pool)
+    _pool->stop();
+
+  for (size_t s = 0; s < _streams.size(); s++)
+    if (_streams[s]->log)
+      _streams[s]->log->stop();
+}
+
+
+
+bool StreamServer::isRunning() const
+{
+  return _feeding > 0;
+}
+
+
+
+void StreamServer::feed(stream* st)
+{
+  while (true) {
+    frameSlot* slot;
+    {
+      unique_lock< mutex > guard(st->lock);
+      st->slotCond.wait(guard, [this, st]{ return !st->free.empty() || !_running; });
+      if (!_running)
+        break;
+      slot = st->free.front();
+      st->free.pop_front();
+    }
+
+    // The grabber hands its frame over without copy, and gets the slot's previous buffer back
+    bool frame_OK = st->grabber.retrieve(slot->frame, slot->stamp);
+
+    {
+      lock_guard< mutex > guard(st->lock);
+      if (!frame_OK) {
+        st->free.push_back(slot);
+        break;
+      }
+      slot->done = false;
+      st->inflight.push_back(slot);
+    }
+    _pool->submit([this, st, slot]{ reproject(st, slot); });
+  }
+
+  _feeding--;
+}
+
+
+
+void StreamServer::reproject(stream* st, frameSlot* slot)
+{
+  slot->clk.start();
+  slot->pipeline.reproject(slot->frame, slot->clk);
+
+  // Queued on this worker, which runs it next unless another one steals it first
+  _pool->submit([this, st, slot]{ scan(st, slot); });
+}
+
+
+
+void StreamServer::scan(stream* st, frameSlot* slot)
+{
+  slot->nsyms = slot->pipeline.scan(slot->symbols, slot->clk);
+  slot->clk.end();
+  complete(st, slot);
+}
+
+
+
+void StreamServer::complete(stream* st, frameSlot* slot)
+{
+  {
+    lock_guard< mutex > guard(st->lock);
+    slot->done = true;
+
+    // Hand out the oldest frames as long as they are done, later ones wait for them
+    while (!st->inflight.empty() && st->inflight.front()->done) {
+      frameSlot* first = st->inflight.front();
+      st->inflight.pop_front();
+
+      if (st->log) {
+        st->log->beginFrame(first->stamp, symbolIDs(first->symbols, st->IDs)); // Only the Metabots are logged
+        for (size_t s = 0; s < first->symbols.size(); s++)
+          if (st->IDs[s] >= 0)
+            st->log->record(st->IDs[s], first->symbols[s].center, first->symbols[s].angle);
+      }
+      st->processed++;
+      st->symbols += first->nsyms;
+      st->last = chrono::steady_clock::now();
+      st->free.push_back(first);
+    }
+  }
+  st->slotCond.notify_all();
+}
+
+
+
+int StreamServer::getStreams() const
+{
+  return _streams.size();
+}
+
+
+
+unsigned long StreamServer::getCaptured(int stream)
+{
+  return _streams[stream]->grabber.getCaptured();
+}
+
+
+
+unsigned long StreamServer::getProcessed(int stream)
+{
+  lock_guard< mutex > guard(_streams[stream]->lock);
+  return _streams[stream]->processed;
+}
+
+
+
+unsigned long StreamServer::getDropped(int stream)
+{
+  return _streams[stream]->grabber.getDropped();
+}
+
+
+
+unsigned long StreamServer::getSymbols(int stream)
+{
+  lock_guard< mutex > guard(_streams[stream]->lock);
+  return _streams[stream]->symbols;
+}
+
+
+
+double StreamServer::getSeconds(int stream)
+{
+  lock_guard< mutex > guard(_streams[stream]->lock);
+  if (! _streams[stream]->processed)
+    return 0;
+  return chrono::duration< double >(_streams[stream]->last - _start).count();
+}
+
+
+
+int StreamServer::getThreads() const
+{
+  return _pool ? _pool->getThreads() : 0;
+}
+
+
+
+unsigned long StreamServer::getTasks() const
+{
+  return _pool ? _pool->getExecuted() : 0;
+}
+
+
+
+unsigned long StreamServer::getStolen() const
+{
+  return _pool ? _pool->getStolen() : 0;
+}
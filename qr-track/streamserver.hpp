@@ -0,0 +1,155 @@
+#ifndef STREAMSERVER_H
+#define STREAMSERVER_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+
+#include "opencv2/core/core.hpp"
+
+#include "framesource.hpp"
+#include "framegrabber.hpp"
+#include "pipeline.hpp"
+#include "workpool.hpp"
+#include "poselog.hpp"
+#include "latency.hpp"
+#include "options.hpp"
+#include "symbols.hpp"
+
+using namespace std;
+using namespace cv;
+
+
+
+/*
+  StreamServer
+  Class tracking symbols in many independent video streams within a single process
+  Each stream has its own capture thread and a few frames in flight, each one held by a slot with its own pipeline,
+  the reprojection tables being shared by the slots of a stream
+  The reprojection of a frame and its scanning are two tasks of a work-stealing pool shared by every stream,
+  so that the cores idle on a quiet stream help the busy ones
+  Results are handed out in capture order for each stream, whatever the order in which their tasks end
+*/
+class StreamServer
+{
+public:
+  /*
+    opts: input
+      Options of the run, applied to the pipelines of every stream
+      Each task runs on a single core: the tiled scanning and the reprojection stripes are disabled
+      The frames of a stream are scanned out of order: opts.roi and opts.budget, which follow the frames one after the other,
+      are disabled, and the margin of the pyramid retries covers the motion between two frames of the same slot
+      With opts.logfile and opts.trajectoryfile, stream s logs its poses into the given files suffixed with ".s"
+    stats: input output
+      Latency histograms, the tasks record the stages of their pipeline into it
+  */
+  StreamServer(const trackOptions& opts, LatencyStats& stats);
+  ~StreamServer();
+
+  /*
+    addStream
+    Function adding a stream before the threads are started
+      M: input
+        Transformation matrix reprojecting the frames of this stream into its scene
+      scnsize: input
+        Dimensions of the scene of this stream
+      source: input
+        Opened video source, owned by the caller and kept alive until stop
+      live: input
+        Whether the source is a live camera, whose frames may be dropped, or a file to be read entirely
+      name: input
+        Name of the source, for the messages
+  */
+  void addStream(const Mat& M, Size scnsize, FrameSource& source, bool live, const string& name);
+
+  /*
+    start
+    Function launching the worker pool, and the capture and feeding threads of every stream
+    Returns if at least one stream could be started
+  */
+  bool start();
+
+  /*
+    stop
+    Function stopping the streams, finishing the frames in flight and stopping every thread
+  */
+  void stop();
+
+  // Whether at least one stream is still being read
+  bool isRunning() const;
+
+  // Per-stream counters
+  int getStreams() const;
+  unsigned long getCaptured(int stream);
+  unsigned long getProcessed(int stream);
+  unsigned long getDropped(int stream);
+  unsigned long getSymbols(int stream);
+  double getSeconds(int stream); // Time from start to the last result of the stream
+
+  // Pool counters
+  int getThreads() const;
+  unsigned long getTasks() const;
+  unsigned long getStolen() const;
+
+private:
+  // Frame in flight, with the pipeline processing it
+  struct frameSlot {
+    frameSlot(const Mat& M, Size scnsize, const trackOptions& opts, const Ptr< WarpMap >& warpmap, const Ptr< GrayWarp >& graywarp, LatencyStats& stats);
+
+    Pipeline pipeline;
+    StageClock clk;
+    Mat frame;
+    chrono::steady_clock::time_point stamp;
+    vector< qrSymbol > symbols;
+    int nsyms;
+    bool done; // Processed, waiting for the previous frames of the stream to be handed out
+  };
+
+  // State of a stream
+  struct stream {
+    stream(const Mat& M, Size scnsize, FrameSource& source, bool live, const string& name);
+
+    Mat M;
+    Size scnsize;
+    string name;                  // Name of the source
+    Ptr< WarpMap > warpmap;       // Reprojection tables shared by the slots
+    Ptr< GrayWarp > graywarp;
+    FrameGrabber grabber;
+    vector< unique_ptr< frameSlot > > slots;
+    deque< frameSlot* > free;     // Slots waiting for a frame
+    deque< frameSlot* > inflight; // Slots being processed, in capture order
+    unique_ptr< PoseLog > log;
+    vector< int > IDs;            // Metabot number of each symbol of the frame being logged, -1 for the other symbols
+    mutex lock;                   // Guards the two queues, the counters and the log
+    condition_variable slotCond;  // Signaled when a slot is freed or the server stops
+    unsigned long processed, symbols;
+    chrono::steady_clock::time_point last; // Time of the last result
+    thread feeder;
+  };
+
+  // Feeding thread main loop of a stream: hands each frame over to a free slot and queues its reprojection
+  void feed(stream* st);
+
+  // Tasks of a frame
+  void reproject(stream* st, frameSlot* slot);
+  void scan(stream* st, frameSlot* slot);
+
+  // Function handing out, in order, the results of the stream that are complete
+  void complete(stream* st, frameSlot* slot);
+
+  trackOptions _opts;
+  LatencyStats& _stats;
+  vector< unique_ptr< stream > > _streams;
+  unique_ptr< WorkPool > _pool;
+  chrono::steady_clock::time_point _start;
+  atomic< bool > _running;
+  atomic< int > _feeding; // Streams still being read
+};
+
+#endif // STREAMSERVER_H
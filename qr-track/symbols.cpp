@@ -0,0 +1,119 @@
+#include <math.h> // atan2
+#include <climits> // INT_MAX
+#define PI 3.1415927
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include "symbols.hpp"
+
+
+
+int extractSymbols(const Image& image, vector< qrSymbol >& symbols, Point2f offset)
+{
+  symbols.clear();
+
+  for(Image::SymbolIterator symbol = image.symbol_begin(); symbol != image.symbol_end(); ++symbol) {
+    qrSymbol s;
+    s.data = symbol->get_data();
+
+    int n = symbol->get_location_size();
+    for(int i = 0; i < n; i++)
+      s.location.push_back(Point2f(symbol->get_location_x(i), symbol->get_location_y(i)) + offset);
+    s.corners = s.location;
+
+    symbols.push_back(s);
+  }
+
+  return symbols.size();
+}
+
+
+
+int scanSymbols(ImageScanner& scanner, const Mat& gray, vector< qrSymbol >& symbols, Point2f offset)
+{
+  // Convert image from cv::Mat to zbar::Image
+  uchar *raw = (uchar*) gray.data; // Raw image data
+  Image image(gray.cols, gray.rows, "Y800", raw, gray.cols * gray.rows);
+  // Using another syntax to call the same constructor seems to cause a systematic crash...
+
+  // Scan for codes in the image
+  scanner.scan(image);
+
+  return extractSymbols(image, symbols, offset);
+}
+
+
+
+void projectSymbols(vector< qrSymbol >& symbols, const Mat& M)
+{
+  for(size_t s = 0; s < symbols.size(); s++)
+    if (! symbols[s].location.empty() )
+      perspectiveTransform(symbols[s].location, symbols[s].corners, M); // Only four points per symbol go through the homography
+}
+
+
+
+void computePose(qrSymbol& symbol)
+{
+  Point2f center, pNorth;
+  int n = symbol.corners.size();
+  for(int i = 0; i < n; i++) {
+    center += symbol.corners[i];
+    if ((i == 0) || (i == 3))
+      pNorth += symbol.corners[i];
+  }
+
+  symbol.center = 0.25 * center; // Center of the QRcode
+  symbol.pNorth = 0.5 * pNorth; // Middle of the north west and north east points of the QR code
+  symbol.angle = atan2(symbol.pNorth.y - symbol.center.y, symbol.pNorth.x - symbol.center.x) * 180. / PI; // Angle of the QR code
+}
+
+
+
+bool symbolID(const string& data, int& ID)
+{
+  if ( data.empty() )
+    return false;
+
+  long value = 0;
+  for(size_t i = 0; i < data.size(); i++) {
+    if ( (data[i] < '0') || (data[i] > '9') )
+      return false;
+    value = value * 10 + (data[i] - '0');
+    if (value > INT_MAX)
+      return false;
+  }
+
+  ID = value;
+  return true;
+}
+
+
+
+int symbolIDs(const vector< qrSymbol >& symbols, vector< int >& IDs)
+{
+  IDs.assign(symbols.size(), -1);
+
+  int found = 0;
+  for(size_t s = 0; s < symbols.size(); s++)
+    if ( symbolID(symbols[s].data, IDs[s]) )
+      found++;
+  return found;
+}
+
+
+
+void drawSymbol(Mat& img, const qrSymbol& symbol, const Scalar& color, bool scene)
+{
+  const vector< Point2f >& points = scene ? symbol.corners : symbol.location;
+  Point2f center, pNorth;
+  int n = points.size();
+  for(int i = 0; i < n; i++) {
+    center += points[i];
+    if ((i == 0) || (i == 3))
+      pNorth += points[i];
+    circle(img, points[i], 6, color, 2);
+  }
+
+  arrowedLine(img, 0.25 * center, 0.5 * pNorth, color, 2);
+}
@@ -0,0 +1,128 @@
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include <vector>
+#include <string>
+
+#include "opencv2/core/core.hpp"
+
+#include <zbar.h>
+
+using namespace std;
+using namespace cv;
+using namespace zbar;
+
+
+
+/*
+  qrSymbol
+  Structure describing a symbol found by the scanner
+  location holds the points as found in the scanned image, corners the same points within the scene plane
+  Both are identical when the scanned image is already reprojected
+*/
+struct qrSymbol {
+  string data;               // Data encoded in the symbol
+  vector< Point2f > location; // Location points in the scanned image
+  vector< Point2f > corners;  // Location points in the scene plane
+  Point2f center;            // Center of the symbol in the scene plane
+  Point2f pNorth;            // Middle of the north west and north east points in the scene plane
+  float angle = 0;           // Orientation angle of the symbol in the scene plane, in degrees
+};
+
+
+
+/*
+  extractSymbols
+  Function gathering the symbols found by a scanner in an image
+    image: input
+      ZBar image on which ImageScanner::scan has been called
+    symbols: output
+      Found symbols, both location and corners are filled with the scanned image coordinates
+    offset: input
+      Position of the scanned image within the image in which coordinates are expected
+    Returns the number of symbols extracted
+*/
+int extractSymbols(const Image& image, vector< qrSymbol >& symbols, Point2f offset = Point2f());
+
+
+
+/*
+  scanSymbols
+  Function scanning a grayscale image and gathering the symbols found
+    scanner: input
+      ZBar scanner to use, its configuration is left untouched
+    gray: input
+      Continuous 8-bit grayscale image to scan
+    symbols: output
+      Found symbols, both location and corners are filled with the scanned image coordinates
+    offset: input
+      Position of the scanned image within the image in which coordinates are expected
+    Returns the number of symbols found
+*/
+int scanSymbols(ImageScanner& scanner, const Mat& gray, vector< qrSymbol >& symbols, Point2f offset = Point2f());
+
+
+
+/*
+  projectSymbols
+  Function reprojecting the corners of symbols found in a raw camera frame into the scene plane
+    symbols: input output
+      Symbols whose location is given in the camera frame, their corners are replaced by the reprojected points
+    M: input
+      Transformation matrix from the camera frame to the scene plane
+*/
+void projectSymbols(vector< qrSymbol >& symbols, const Mat& M);
+
+
+
+/*
+  computePose
+  Function computing the position and orientation of a symbol from its corners in the scene plane
+    symbol: input output
+      Symbol whose center, pNorth and angle are set
+*/
+void computePose(qrSymbol& symbol);
+
+
+
+/*
+  symbolID
+  Function reading the Metabot number encoded in a symbol's data
+    data: input
+      Data encoded in the symbol
+    ID: output
+      Number read, left untouched if the data is not a Metabot number
+    Returns if the whole data is a decimal number between 0 and INT_MAX
+*/
+bool symbolID(const string& data, int& ID);
+
+
+
+/*
+  symbolIDs
+  Function reading the Metabot number of every symbol found in a frame
+    symbols: input
+      Symbols found in the frame
+    IDs: output
+      Metabot number of each symbol, -1 for the other symbols: anchor tags, stray codes or partial decodes
+    Returns the number of Metabots among the symbols
+*/
+int symbolIDs(const vector< qrSymbol >& symbols, vector< int >& IDs);
+
+
+
+/*
+  drawSymbol
+  Function highlighting a symbol in the image it was found in
+    img: input output
+      Image on which location points and orientation are drawn
+    symbol: input
+      Symbol to draw, only its location points, or its corners, are used
+    color: input
+      Color of the drawings
+    scene: input
+      Whether img is the scene plane, in which case the corners are drawn instead of the location points
+*/
+void drawSymbol(Mat& img, const qrSymbol& symbol, const Scalar& color, bool scene = false);
+
+#endif // SYMBOLS_H
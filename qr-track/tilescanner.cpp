@@ -0,0 +1,149 @@
+#include <algorithm>
+
+#include "tilescanner.hpp"
+
+
+
+TileScanner::TileScanner(int footprint, int nthreads) :
+  _footprint(footprint > 0 ? footprint : 1),
+  _gray(NULL),
+  _next(0),
+  _generation(0),
+  _pending(0),
+  _running(true)
+{
+  if (nthreads <= 0)
+    nthreads = getNumberOfCPUs();
+
+  for (int i = 0; i < nthreads; i++) {
+    _workers.push_back(unique_ptr< tileWorker >(new tileWorker));
+    _workers.back()->scanner.set_config(ZBAR_QRCODE, ZBAR_CFG_ENABLE, 1);
+  }
+  for (int i = 0; i < nthreads; i++)
+    _workers[i]->th = thread(&TileScanner::work, this, _workers[i].get());
+}
+
+
+
+TileScanner::~TileScanner()
+{
+  {
+    lock_guard< mutex > guard(_lock);
+    _running = false;
+  }
+  _startCond.notify_all();
+
+  for (size_t i = 0; i < _workers.size(); i++)
+    if (_workers[i]->th.joinable())
+      _workers[i]->th.join();
+}
+
+
+
+void TileScanner::layout(Size imsize)
+{
+  _tiles.clear();
+  _laidout = imsize;
+
+  // Tiles three footprints wide, one footprint of overlap: any symbol fits entirely within one of them
+  int side = 3 * _footprint, step = side - _footprint;
+
+  for (int y = 0; y < imsize.height; y += step) {
+    int h = min(side, imsize.height - y);
+    for (int x = 0; x < imsize.width; x += step) {
+      int w = min(side, imsize.width - x);
+      _tiles.push_back(Rect(x, y, w, h));
+      if (x + w >= imsize.width)
+        break;
+    }
+    if (y + h >= imsize.height)
+      break;
+  }
+}
+
+
+
+int TileScanner::scan(const Mat& gray, vector< qrSymbol >& symbols)
+{
+  if (gray.size() != _laidout)
+    layout(gray.size());
+
+  // Hand the image over to the workers and wait for all of them
+  {
+    unique_lock< mutex > guard(_lock);
+    _gray = &gray;
+    _next = 0;
+    _pending = _workers.size();
+    _generation++;
+    _startCond.notify_all();
+    _doneCond.wait(guard, [this]{ return _pending == 0; });
+  }
+
+  // Merge the results, a symbol decoded in two overlapping tiles has the same data and about the same location
+  symbols.clear();
+  float mindist = 0.5 * _footprint;
+  for (size_t w = 0; w < _workers.size(); w++) {
+    vector< qrSymbol >& results = _workers[w]->results;
+    for (size_t r = 0; r < results.size(); r++) {
+      bool duplicate = false;
+      for (size_t s = 0; (s < symbols.size()) && !duplicate; s++) {
+        Point2f d = symbols[s].location[0] - results[r].location[0];
+        duplicate = (symbols[s].data == results[r].data) && (d.x * d.x + d.y * d.y < mindist * mindist);
+      }
+      if (! duplicate)
+        symbols.push_back(results[r]);
+    }
+  }
+
+  return symbols.size();
+}
+
+
+
+void TileScanner::work(tileWorker* w)
+{
+  unsigned long seen = 0; // Last image handled by this worker
+
+  while (true) {
+    {
+      unique_lock< mutex > guard(_lock);
+      _startCond.wait(guard, [this, seen]{ return (_generation != seen) || !_running; });
+      if (! _running)
+        return;
+      seen = _generation;
+    }
+
+    // Take tiles until none is left
+    w->results.clear();
+    for (int t = _next++; t < (int) _tiles.size(); t = _next++) {
+      (*_gray)(_tiles[t]).copyTo(w->buffer);
+      scanSymbols(w->scanner, w->buffer, w->found, Point2f(_tiles[t].x, _tiles[t].y));
+      for (size_t s = 0; s < w->found.size(); s++)
+        if (! w->found[s].location.empty() )
+          w->results.push_back(w->found[s]);
+    }
+
+    {
+      lock_guard< mutex > guard(_lock);
+      if (--_pending == 0)
+        _doneCond.notify_one();
+    }
+  }
+}
+
+
+
+int TileScanner::getThreads() const
+{
+  return _workers.size();
+}
+
+
+
+long TileScanner::getScanned() const
+{
+  long scanned = 0;
+  for (size_t t = 0; t < _tiles.size(); t++)
+    scanned += _tiles[t].area();
+  return scanned;
+}
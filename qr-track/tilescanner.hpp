@@ -0,0 +1,89 @@
+#ifndef TILESCANNER_H
+#define TILESCANNER_H
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#include "opencv2/core/core.hpp"
+
+#include <zbar.h>
+
+#include "symbols.hpp"
+
+using namespace std;
+using namespace cv;
+using namespace zbar;
+
+
+
+/*
+  TileScanner
+  Class scanning an image split into overlapping tiles on a pool of worker threads
+  Tiles overlap by the largest footprint of a symbol, so that every symbol lies entirely within at least one tile
+  Each worker owns its ZBar scanner, symbols found twice in an overlap are merged afterwards
+*/
+class TileScanner
+{
+public:
+  /*
+    footprint: input
+      Largest side in pixels of a symbol, quiet zone included, in the scanned image
+    nthreads: input
+      Number of worker threads, 0 to use one per CPU
+  */
+  TileScanner(int footprint, int nthreads = 0);
+  ~TileScanner();
+
+  /*
+    scan
+    Function scanning the whole image tile by tile
+      gray: input
+        8-bit grayscale image to scan
+      symbols: output
+        Symbols found, with coordinates in the whole image, each one reported once
+      Returns the number of symbols found
+  */
+  int scan(const Mat& gray, vector< qrSymbol >& symbols);
+
+  // Number of worker threads
+  int getThreads() const;
+
+  // Number of pixels handed to ZBar by the last scan, the overlaps between tiles counted twice
+  long getScanned() const;
+
+private:
+  // State owned by a worker thread
+  struct tileWorker {
+    ImageScanner scanner;
+    Mat buffer;                 // Continuous copy of the tile being scanned
+    vector< qrSymbol > found;   // Symbols found in the tile being scanned
+    vector< qrSymbol > results; // Symbols found in every tile scanned by this worker for the current image
+    thread th;
+  };
+
+  // Worker thread main loop
+  void work(tileWorker* w);
+
+  // Function computing the tiles covering an image of the given size
+  void layout(Size imsize);
+
+  vector< unique_ptr< tileWorker > > _workers;
+  vector< Rect > _tiles;
+  Size _laidout; // Image size the tiles were computed for
+  int _footprint;
+
+  const Mat* _gray;       // Image being scanned
+  atomic< int > _next;    // Index of the next tile to scan
+  mutex _lock;
+  condition_variable _startCond; // Signaled when a new image is to be scanned or the pool stops
+  condition_variable _doneCond;  // Signaled when the last worker is done with the current image
+  unsigned long _generation;     // Number of images submitted
+  int _pending;                  // Workers still busy with the current image
+  bool _running;
+};
+
+#endif // TILESCANNER_H
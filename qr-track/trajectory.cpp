@@ -0,0 +1,400 @@
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "trajectory.hpp"
+
+
+
+// Unsigned integer in 7-bit groups, least significant first, the high bit telling whether another group follows
+static void putVarint(vector< uint8_t >& out, uint64_t v)
+{
+  while (v >= 0x80) {
+    out.push_back((uint8_t) (v | 0x80));
+    v >>= 7;
+  }
+  out.push_back((uint8_t) v);
+}
+
+// Signed integer mapped to an unsigned one, so that small magnitudes take few bytes either way
+static void putSigned(vector< uint8_t >& out, int64_t v)
+{
+  putVarint(out, ((uint64_t) v << 1) ^ (uint64_t) (v >> 63));
+}
+
+static bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v)
+{
+  v = 0;
+  for (int shift = 0; (p < end) && (shift < 64); shift += 7) {
+    uint8_t byte = *p++;
+    v |= (uint64_t) (byte & 0x7f) << shift;
+    if (! (byte & 0x80) )
+      return true;
+  }
+  return false;
+}
+
+static bool getSigned(const uint8_t*& p, const uint8_t* end, int64_t& v)
+{
+  uint64_t u;
+  if (! getVarint(p, end, u) )
+    return false;
+  v = (int64_t) (u >> 1) ^ -(int64_t) (u & 1);
+  return true;
+}
+
+
+
+TrajectoryWriter::TrajectoryWriter(int64_t interval, float posQuantum, float angleQuantum) :
+  _file(NULL),
+  _interval(interval > 0 ? interval : 1),
+  _posQuantum(posQuantum),
+  _angleQuantum(angleQuantum),
+  _bytes(0),
+  _inFrame(false),
+  _stamp(0),
+  _previous(0)
+{
+  memset(&_block, 0, sizeof(_block));
+}
+
+
+
+TrajectoryWriter::~TrajectoryWriter()
+{
+  close();
+}
+
+
+
+bool TrajectoryWriter::open(const string& path, int64_t start)
+{
+  close();
+  _file = fopen(path.c_str(), "wb");
+  if (!_file)
+    return false;
+
+  trajHeader header;
+  memcpy(header.magic, TRAJECTORY_MAGIC, 8);
+  header.start = start;
+  header.posQuantum = _posQuantum;
+  header.angleQuantum = _angleQuantum;
+  fwrite(&header, sizeof(header), 1, _file);
+  fflush(_file);
+  _bytes = sizeof(header);
+
+  _inFrame = false;
+  _block.frames = 0;
+  return true;
+}
+
+
+
+void TrajectoryWriter::close()
+{
+  if (!_file)
+    return;
+
+  endFrame();
+  flush();
+  fclose(_file);
+  _file = NULL;
+}
+
+
+
+void TrajectoryWriter::beginFrame(int64_t stamp)
+{
+  endFrame();
+
+  // A block spanning the interval is appended, the frame starts the next one
+  if ( (_block.frames > 0) && (stamp - _block.first >= _interval) )
+    flush();
+
+  _stamp = stamp;
+  _inFrame = true;
+}
+
+
+
+void TrajectoryWriter::add(int ID, float x, float y, float angle)
+{
+  if (!_inFrame)
+    return;
+
+  quantized q;
+  q.x = (int32_t) lrintf(x / _posQuantum);
+  q.y = (int32_t) lrintf(y / _posQuantum);
+  q.angle = (int32_t) lrintf(angle / _angleQuantum);
+  _frame.push_back(make_pair(ID, q));
+}
+
+
+
+unsigned long TrajectoryWriter::getBytes() const
+{
+  return _bytes + (_block.frames ? sizeof(_block) + _payload.size() : 0);
+}
+
+
+
+void TrajectoryWriter::endFrame()
+{
+  if (!_inFrame)
+    return;
+  _inFrame = false;
+
+  if (_block.frames == 0) {
+    _block.magic = TRAJECTORY_BLOCK;
+    _block.first = _stamp;
+    _block.poses = 0;
+    _block.minID = INT32_MAX;
+    _block.maxID = INT32_MIN;
+    _previous = _stamp;
+    _payload.clear();
+    _last.clear();
+  }
+
+  // Ascending IDs, so that their differences are small and positive
+  sort(_frame.begin(), _frame.end(), [](const pair< int, quantized >& a, const pair< int, quantized >& b) { return a.first < b.first; });
+
+  putVarint(_payload, (uint64_t) max< int64_t >(_stamp - _previous, 0));
+  putVarint(_payload, _frame.size());
+  int previousID = 0;
+  for (size_t i = 0; i < _frame.size(); i++) {
+    int ID = _frame[i].first;
+    const quantized& q = _frame[i].second;
+
+    quantized last = { 0, 0, 0 }; // Absolute values for the first pose of a Metabot in the block
+    unordered_map< int, quantized >::iterator found = _last.find(ID);
+    if (found != _last.end())
+      last = found->second;
+
+    putSigned(_payload, (int64_t) ID - previousID);
+    putSigned(_payload, (int64_t) q.x - last.x);
+    putSigned(_payload, (int64_t) q.y - last.y);
+    putSigned(_payload, (int64_t) q.angle - last.angle);
+
+    _last[ID] = q;
+    previousID = ID;
+    _block.minID = min(_block.minID, ID);
+    _block.maxID = max(_block.maxID, ID);
+  }
+
+  _previous = max(_stamp, _previous);
+  _block.last = _previous;
+  _block.frames++;
+  _block.poses += _frame.size();
+  _frame.clear();
+}
+
+
+
+void TrajectoryWriter::flush()
+{
+  if ( !_file || (_block.frames == 0) )
+    return;
+
+  _block.size = _payload.size();
+  fwrite(&_block, sizeof(_block), 1, _file);
+  fwrite(_payload.data(), 1, _payload.size(), _file);
+  fflush(_file); // A crash loses at most the block being encoded
+  _bytes += sizeof(_block) + _payload.size();
+
+  _block.frames = 0;
+}
+
+
+
+TrajectoryReader::TrajectoryReader() :
+  _data(NULL),
+  _size(0)
+{
+  memset(&_header, 0, sizeof(_header));
+}
+
+
+
+TrajectoryReader::~TrajectoryReader()
+{
+  close();
+}
+
+
+
+bool TrajectoryReader::open(const string& path)
+{
+  close();
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if ( (fstat(fd, &st) != 0) || (st.st_size < (off_t) sizeof(trajHeader)) ) {
+    ::close(fd);
+    return false;
+  }
+
+  void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd); // The mapping keeps the file open
+  if (data == MAP_FAILED)
+    return false;
+  _data = (const uint8_t*) data;
+  _size = st.st_size;
+
+  memcpy(&_header, _data, sizeof(_header));
+  if (memcmp(_header.magic, TRAJECTORY_MAGIC, 8) != 0) {
+    close();
+    return false;
+  }
+
+  // Hop from block header to block header, the last block may be incomplete
+  size_t offset = sizeof(trajHeader);
+  while (offset + sizeof(trajBlock) <= _size) {
+    trajBlock block;
+    memcpy(&block, _data + offset, sizeof(block));
+    if ( (block.magic != TRAJECTORY_BLOCK) || (block.size > _size - offset - sizeof(block)) )
+      break;
+
+    _blocks.push_back(block);
+    _offsets.push_back(offset + sizeof(block));
+    offset += sizeof(block) + block.size;
+  }
+
+  return true;
+}
+
+
+
+void TrajectoryReader::close()
+{
+  if (_data)
+    munmap((void*) _data, _size);
+  _data = NULL;
+  _size = 0;
+  _blocks.clear();
+  _offsets.clear();
+}
+
+
+
+template< typename Visitor >
+void TrajectoryReader::decode(size_t b, Visitor visit) const
+{
+  const uint8_t* p = _data + _offsets[b];
+  const uint8_t* end = p + _blocks[b].size;
+
+  struct quantized {
+    int64_t x, y, angle;
+  };
+  unordered_map< int, quantized > last;
+  vector< trajPose > frame;
+  int64_t stamp = _blocks[b].first;
+
+  for (uint32_t f = 0; f < _blocks[b].frames; f++) {
+    uint64_t dt, n;
+    if (! (getVarint(p, end, dt) && getVarint(p, end, n)) )
+      return;
+    stamp += dt;
+
+    frame.clear();
+    int64_t ID = 0;
+    for (uint64_t i = 0; i < n; i++) {
+      int64_t dID, dx, dy, da;
+      if (! (getSigned(p, end, dID) && getSigned(p, end, dx) && getSigned(p, end, dy) && getSigned(p, end, da)) )
+        return;
+      ID += dID;
+
+      quantized& q = last[ID]; // Zero for the first pose of a Metabot in the block
+      q.x += dx;
+      q.y += dy;
+      q.angle += da;
+
+      trajPose pose;
+      pose.stamp = stamp;
+      pose.ID = ID;
+      pose.x = q.x * _header.posQuantum;
+      pose.y = q.y * _header.posQuantum;
+      pose.angle = q.angle * _header.angleQuantum;
+      frame.push_back(pose);
+    }
+
+    if (! visit(stamp, frame) )
+      return;
+  }
+}
+
+
+
+size_t TrajectoryReader::read(int64_t from, int64_t to, int minID, int maxID, vector< trajPose >& poses) const
+{
+  poses.clear();
+
+  // First block ending at or after the start of the span
+  size_t b = lower_bound(_blocks.begin(), _blocks.end(), from, [](const trajBlock& block, int64_t t) { return block.last < t; }) - _blocks.begin();
+
+  for (; (b < _blocks.size()) && (_blocks[b].first <= to); b++) {
+    if ( (_blocks[b].maxID < minID) || (_blocks[b].minID > maxID) )
+      continue; // None of the requested Metabots, skipped without decoding
+
+    decode(b, [&](int64_t stamp, const vector< trajPose >& frame) {
+      if (stamp > to)
+        return false;
+      if (stamp >= from)
+        for (size_t i = 0; i < frame.size(); i++)
+          if ( (frame[i].ID >= minID) && (frame[i].ID <= maxID) )
+            poses.push_back(frame[i]);
+      return true;
+    });
+  }
+
+  return poses.size();
+}
+
+
+
+bool TrajectoryReader::frameAt(int64_t when, vector< trajPose >& poses) const
+{
+  poses.clear();
+
+  // Last block starting at or before the given time
+  size_t b = upper_bound(_blocks.begin(), _blocks.end(), when, [](int64_t t, const trajBlock& block) { return t < block.first; }) - _blocks.begin();
+  if (b == 0)
+    return false;
+  b--;
+
+  decode(b, [&](int64_t stamp, const vector< trajPose >& frame) {
+    if (stamp > when)
+      return false;
+    poses = frame;
+    return true;
+  });
+
+  return true;
+}
+
+
+
+const trajHeader& TrajectoryReader::getHeader() const
+{
+  return _header;
+}
+
+
+
+const vector< trajBlock >& TrajectoryReader::getBlocks() const
+{
+  return _blocks;
+}
+
+
+
+size_t TrajectoryReader::getBytes() const
+{
+  return _size;
+}
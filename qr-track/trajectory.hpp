@@ -0,0 +1,231 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <stdio.h>
+#include <stdint.h>
+
+using namespace std;
+
+
+
+/*
+  Trajectory files
+  Append-only history of the poses of every Metabot, made of a header followed by independent blocks
+  A block covers about a second of frames: within it, each frame stores its time and poses as variable-length
+  integers holding the differences with the previous frame, and with the previous pose of the same Metabot
+  Every block starts again from absolute values, so that it can be decoded on its own
+  The fixed-size block headers form the seek index: they give the time span, the ID range and the length of their block,
+  so that readers hop from one to the next without decoding, and only decode the blocks a query needs
+  Positions and angles are quantized, the quanta being stored in the file header
+*/
+
+// Trajectory files start with this magic string
+#define TRAJECTORY_MAGIC "QRTRAJ01"
+// Every block header starts with this word
+#define TRAJECTORY_BLOCK 0x42545251 // "QRTB"
+
+/*
+  trajHeader
+  Structure of the file header, written as is in the host byte order
+*/
+struct trajHeader {
+  char magic[8];      // TRAJECTORY_MAGIC
+  int64_t start;      // System time at which the file was opened, in microseconds since the epoch
+  float posQuantum;   // Scene units per position step
+  float angleQuantum; // Degrees per angle step
+};
+
+/*
+  trajBlock
+  Structure of a block header, written as is in the host byte order before the encoded frames of the block
+*/
+struct trajBlock {
+  uint32_t magic;  // TRAJECTORY_BLOCK
+  uint32_t size;   // Length in bytes of the encoded frames following the header
+  int64_t first;   // Time of the first frame, in microseconds since the file was opened
+  int64_t last;    // Time of the last frame
+  uint32_t frames; // Number of frames
+  uint32_t poses;  // Number of poses in all frames
+  int32_t minID;   // Smallest and largest IDs of the poses, minID > maxID if there are none
+  int32_t maxID;
+};
+
+/*
+  trajPose
+  Structure of a decoded pose
+*/
+struct trajPose {
+  int64_t stamp; // Capture time, in microseconds since the file was opened
+  int ID;
+  float x;
+  float y;
+  float angle;
+};
+
+
+
+/*
+  TrajectoryWriter
+  Class appending frames of poses to a trajectory file
+  Frames are encoded in memory and a block is appended once it spans the block interval, or when the file is closed
+*/
+class TrajectoryWriter
+{
+public:
+  /*
+    interval: input
+      Time span of a block in microseconds, which is also the granularity of the seek index
+    posQuantum: input
+      Position step in scene units
+    angleQuantum: input
+      Angle step in degrees
+  */
+  TrajectoryWriter(int64_t interval = 1000000, float posQuantum = 0.1f, float angleQuantum = 0.1f);
+  ~TrajectoryWriter();
+
+  /*
+    open
+    Function creating the file and writing its header
+      path: input
+        Full path and name of the file, truncated if it exists
+      start: input
+        System time the frame times are relative to, in microseconds since the epoch
+      Returns if the file could be created
+  */
+  bool open(const string& path, int64_t start);
+
+  /*
+    close
+    Function appending the last block and closing the file
+  */
+  void close();
+
+  /*
+    beginFrame
+    Function starting a new frame, the poses added next belong to it
+      stamp: input
+        Capture time of the frame in microseconds, never earlier than the previous frame
+  */
+  void beginFrame(int64_t stamp);
+
+  /*
+    add
+    Function adding a pose to the current frame
+      ID: input
+        ID of the Metabot
+      x, y: input
+        Position of the center of the Metabot within the scene plane
+      angle: input
+        Orientation angle in degrees
+  */
+  void add(int ID, float x, float y, float angle);
+
+  // Size of the file so far, in bytes
+  unsigned long getBytes() const;
+
+private:
+  // Function encoding the current frame into the block
+  void endFrame();
+  // Function appending the current block to the file
+  void flush();
+
+  struct quantized {
+    int32_t x, y, angle;
+  };
+
+  FILE* _file;
+  int64_t _interval;
+  float _posQuantum, _angleQuantum;
+  unsigned long _bytes;
+
+  bool _inFrame;
+  int64_t _stamp;                 // Time of the current frame
+  vector< pair< int, quantized > > _frame; // Poses of the current frame
+
+  trajBlock _block;               // Header of the current block
+  vector< uint8_t > _payload;     // Encoded frames of the current block
+  int64_t _previous;              // Time of the last frame encoded in the block
+  unordered_map< int, quantized > _last; // Last pose of each Metabot within the block
+};
+
+
+
+/*
+  TrajectoryReader
+  Class giving access to a trajectory file mapped in memory
+  Opening only reads the block headers, queries then decode the blocks overlapping the requested time span and IDs
+  A block cut short by a crash of the writer is ignored
+*/
+class TrajectoryReader
+{
+public:
+  TrajectoryReader();
+  ~TrajectoryReader();
+
+  /*
+    open
+    Function mapping a trajectory file and indexing its blocks
+      path: input
+        Full path and name of the file
+      Returns if the file could be mapped and is a trajectory file
+  */
+  bool open(const string& path);
+
+  /*
+    close
+    Function unmapping the file
+  */
+  void close();
+
+  /*
+    read
+    Function gathering the poses within a time span and an ID range
+      from, to: input
+        Bounds of the time span, included, in microseconds since the file was opened
+      minID, maxID: input
+        Bounds of the ID range, included
+      poses: output
+        Poses found, ordered by time then ID
+      Returns the number of poses found
+  */
+  size_t read(int64_t from, int64_t to, int minID, int maxID, vector< trajPose >& poses) const;
+
+  /*
+    frameAt
+    Function giving the last frame captured at or before a given time
+      when: input
+        Time in microseconds since the file was opened
+      poses: output
+        Poses of the frame, empty if there is none or if nothing was found in it
+      Returns false if no frame was captured before the given time
+  */
+  bool frameAt(int64_t when, vector< trajPose >& poses) const;
+
+  // Header of the file
+  const trajHeader& getHeader() const;
+
+  // Block headers, ordered by time
+  const vector< trajBlock >& getBlocks() const;
+
+  // Size of the mapped file in bytes
+  size_t getBytes() const;
+
+private:
+  /*
+    Function decoding a block, calling a visitor on each frame
+    The visitor gets the frame time and its poses, and returns false to stop the decoding
+  */
+  template< typename Visitor >
+  void decode(size_t b, Visitor visit) const;
+
+  const uint8_t* _data;
+  size_t _size;
+  trajHeader _header;
+  vector< trajBlock > _blocks;
+  vector< size_t > _offsets; // Offset of the encoded frames of each block
+};
+
+#endif // TRAJECTORY_H
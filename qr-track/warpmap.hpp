@@ -0,0 +1,73 @@
+#ifndef WARPMAP_H
+#define WARPMAP_H
+
+#include "opencv2/core/core.hpp"
+
+using namespace std;
+using namespace cv;
+
+
+
+/*
+  WarpMap
+  Class applying a constant perspective transformation through precomputed remap tables
+  The source coordinates of every scene pixel are computed once from the transformation matrix,
+  then stored as fixed-point tables (integer coordinates plus interpolation weights index)
+  Each frame is then remapped in horizontal stripes processed in parallel
+*/
+class WarpMap
+{
+public:
+  /*
+    M: input
+      Transformation matrix from the camera frame to the scene plane, as loaded by readProj
+    scnsize: input
+      Dimensions of the scene, bounding the reprojected images
+    nstripes: input
+      Number of row stripes processed in parallel, 0 to use one per CPU
+  */
+  WarpMap(const Mat& M, Size scnsize, int nstripes = 0);
+
+  /*
+    apply
+    Function reprojecting an image with the precomputed tables
+    Gives the same result as warpPerspective with linear interpolation and a black border
+      src: input
+        Camera frame, of any type supported by remap
+        Converting it to grayscale beforehand warps a single channel instead of three
+      dst: output
+        Reprojected image, with the dimensions of the scene and the type of src
+  */
+  void apply(const Mat& src, Mat& dst) const;
+
+  // Number of row stripes processed in parallel
+  int getStripes() const;
+
+private:
+  Mat _map1; // Integer source coordinates, CV_16SC2
+  Mat _map2; // Interpolation table indices, CV_16UC1
+  Size _size;
+  int _nstripes;
+};
+
+
+
+/*
+  benchWarp
+  Function measuring the per-frame cost of the reprojection, with and without the precomputed tables, and in a single pass to grayscale
+  The single pass is also checked against its scalar reference and against the original path
+  Results are written in the console
+    frame: input
+      Camera frame used as sample, in BGR
+    M: input
+      Transformation matrix from the camera frame to the scene plane
+    scnsize: input
+      Dimensions of the scene
+    warpmap: input
+      Precomputed tables built from M and scnsize
+    iterations: input
+      Number of reprojections timed for each method
+*/
+void benchWarp(const Mat& frame, const Mat& M, Size scnsize, const WarpMap& warpmap, int iterations);
+
+#endif // WARPMAP_H
@@ -0,0 +1,135 @@
+#include "workpool.hpp"
+
+// Pool and index of the worker running on the current thread, so that its submissions stay local
+static thread_local WorkPool* currentPool = NULL;
+static thread_local int currentWorker = -1;
+
+
+
+WorkPool::WorkPool(int nthreads) :
+  _next(0),
+  _queued(0),
+  _executed(0),
+  _stolen(0),
+  _running(true)
+{
+  if (nthreads <= 0)
+    nthreads = max(1u, thread::hardware_concurrency());
+
+  for (int w = 0; w < nthreads; w++)
+    _workers.push_back(unique_ptr< poolWorker >(new poolWorker));
+  for (int w = 0; w < nthreads; w++)
+    _workers[w]->th = thread(&WorkPool::work, this, w);
+}
+
+
+
+WorkPool::~WorkPool()
+{
+  stop();
+}
+
+
+
+void WorkPool::submit(task t)
+{
+  int index = (currentPool == this) ? currentWorker : (int) (_next++ % _workers.size());
+  {
+    lock_guard<mutex> guard(_workers[index]->lock);
+    _workers[index]->tasks.push_back(move(t));
+  }
+
+  {
+    lock_guard<mutex> guard(_idleLock); // Counted under the lock, so that a worker about to sleep does not miss it
+    _queued++;
+  }
+  _idleCond.notify_one();
+}
+
+
+
+void WorkPool::stop()
+{
+  {
+    lock_guard<mutex> guard(_idleLock);
+    _running = false;
+  }
+  _idleCond.notify_all();
+
+  for (size_t w = 0; w < _workers.size(); w++)
+    if (_workers[w]->th.joinable())
+      _workers[w]->th.join();
+}
+
+
+
+bool WorkPool::take(int index, task& t)
+{
+  { // Own queue first, newest task
+    poolWorker& own = *_workers[index];
+    lock_guard<mutex> guard(own.lock);
+    if (! own.tasks.empty() ) {
+      t = move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+
+  // Then the oldest task of the other workers, starting from the next one
+  for (size_t k = 1; k < _workers.size(); k++) {
+    poolWorker& other = *_workers[(index + k) % _workers.size()];
+    lock_guard<mutex> guard(other.lock);
+    if (! other.tasks.empty() ) {
+      t = move(other.tasks.front());
+      other.tasks.pop_front();
+      _stolen++;
+      return true;
+    }
+  }
+  return false;
+}
+
+
+
+void WorkPool::work(int index)
+{
+  currentPool = this;
+  currentWorker = index;
+
+  task t;
+  while (true) {
+    if ( take(index, t) ) {
+      _queued--;
+      t();
+      t = nullptr; // Release what the task captured before sleeping
+      _executed++;
+      continue;
+    }
+
+    unique_lock<mutex> guard(_idleLock);
+    _idleCond.wait(guard, [this]{ return (_queued > 0) || !_running; });
+    if ( (_queued <= 0) && !_running ) // Every task has been run
+      break;
+  }
+}
+
+
+
+int WorkPool::getThreads() const
+{
+  return _workers.size();
+}
+
+
+
+unsigned long WorkPool::getExecuted() const
+{
+  return _executed;
+}
+
+
+
+unsigned long WorkPool::getStolen() const
+{
+  return _stolen;
+}
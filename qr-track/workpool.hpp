@@ -0,0 +1,82 @@
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+using namespace std;
+
+
+
+/*
+  WorkPool
+  Class running tasks on a pool of worker threads balanced by work stealing
+  Each worker has its own queue: tasks submitted by a worker, such as the continuation of its current task,
+  go to its own queue and are run last in first out, while the data they use is still in its caches
+  A worker whose queue is empty steals the oldest task of another worker, so that no core stays idle while work remains
+  Tasks submitted from other threads are spread over the queues in turn
+*/
+class WorkPool
+{
+public:
+  typedef function< void() > task;
+
+  /*
+    nthreads: input
+      Number of worker threads, 0 to use one per CPU
+  */
+  WorkPool(int nthreads = 0);
+  ~WorkPool();
+
+  /*
+    submit
+    Function queuing a task, from any thread
+      t: input
+        Task to run, it may submit other tasks
+  */
+  void submit(task t);
+
+  /*
+    stop
+    Function running the tasks still queued, then stopping the workers and waiting for them to end
+  */
+  void stop();
+
+  // Number of worker threads
+  int getThreads() const;
+
+  // Counters: tasks run, tasks run by another worker than the one they were queued on
+  unsigned long getExecuted() const;
+  unsigned long getStolen() const;
+
+private:
+  // State owned by a worker thread
+  struct poolWorker {
+    mutex lock;          // Guards the queue, held only to push or pop
+    deque< task > tasks;
+    thread th;
+  };
+
+  // Worker thread main loop
+  void work(int index);
+
+  // Function taking a task from the queue of a worker, or else from the others
+  bool take(int index, task& t);
+
+  vector< unique_ptr< poolWorker > > _workers;
+  atomic< unsigned > _next;     // Queue of the next task submitted from outside the pool
+  atomic< long > _queued;       // Tasks queued and not taken yet
+  atomic< unsigned long > _executed, _stolen;
+
+  mutex _idleLock;
+  condition_variable _idleCond; // Signaled when a task is queued or the pool stops
+  bool _running;
+};
+
+#endif // WORKPOOL_H